@@ -0,0 +1,109 @@
+#pragma once
+#ifdef AGISCORE_EXPORTS
+#define AGIS_API __declspec(dllexport)
+#else
+#define AGIS_API __declspec(dllimport)
+#endif
+#include <vector>
+#include <span>
+#include <string>
+#include <expected>
+
+#include "AgisErrors.h"
+#include "AgisFunctional.h"
+#include "Asset/Asset.Core.h"
+
+class Exchange;
+
+
+/**
+ * @brief instruction set of a compiled asset lambda. Every instruction writes one register that
+ * holds a value and an error for every asset in the exchange, errors propagate the way the nodes
+ * return them.
+*/
+enum class AssetLambdaOpCode : uint8_t {
+	READ,		///< read a column at a relative row (row < 0 is a shift back in time), a row outside the data is an error
+	OBSERVE,	///< read the current result of an asset observer
+	CONSTANT,	///< broadcast a scalar
+	BINARY,		///< apply an AgisOpperationType, the right operand is evaluated first and NaN there gives NaN
+	COMPARE		///< apply an AgisLogicalType, the left operand is evaluated first. Filters to NaN or casts to 0/1
+};
+
+
+//============================================================================
+struct AssetLambdaInstruction {
+	AssetLambdaOpCode op_code;
+
+	/**
+	 * @brief output register and the input registers of BINARY and COMPARE
+	*/
+	size_t dst = 0;
+	size_t lhs = 0;
+	size_t rhs = 0;
+
+	/**
+	 * @brief READ column index and relative row, OBSERVE index into the observer names
+	*/
+	size_t col_index = 0;
+	int row = 0;
+
+	double value = 0.0;
+	AgisOpperationType opperation = AgisOpperationType::IDENTITY;
+	AgisLogicalType logical_type = AgisLogicalType::EQUAL;
+	bool numeric_cast = false;
+};
+
+
+//============================================================================
+/**
+ * @brief flat form of an asset lambda node graph. The tree is lowered once into a list of
+ * instructions over registers of size N (one slot per exchange asset) and each step every
+ * instruction is evaluated across all assets at once, so the per asset cost is a few tight loops
+ * instead of a chain of virtual and std::function calls.
+*/
+class AssetLambdaProgram {
+public:
+	AssetLambdaProgram() = default;
+
+	size_t emit_read(size_t col_index, int row);
+	size_t emit_observe(std::string const& observer_name);
+	size_t emit_constant(double value);
+	size_t emit_binary(AgisOpperationType opperation, size_t lhs, size_t rhs);
+	size_t emit_compare(AgisLogicalType logical_type, size_t lhs, size_t rhs, bool numeric_cast);
+
+	/**
+	 * @brief evaluate the program for the current row of the exchange
+	 * @param exchange exchange the assets are listed on, column panels are used when present
+	 * @param assets assets of the exchange in exchange order
+	 * @param active mask of the assets to evaluate, all other slots are left NaN
+	 * @param out output of the last instruction, one value per asset
+	 * @return the error of the first active asset in exchange order whose evaluation failed, the
+	 * error the tree would return
+	*/
+	std::expected<bool, AgisStatusCode> run(
+		Exchange const* exchange,
+		std::span<AssetHandle const> assets,
+		std::span<char const> active,
+		std::span<double> out
+	) noexcept;
+
+	size_t size() const noexcept { return this->instructions.size(); }
+	size_t register_count() const noexcept { return this->registers; }
+
+private:
+	size_t emit(AssetLambdaInstruction instruction);
+
+	std::vector<AssetLambdaInstruction> instructions;
+	std::vector<std::string> observer_names;
+
+	/**
+	 * @brief register file, register r of the current run is [r * N, (r + 1) * N)
+	*/
+	std::vector<double> register_file;
+
+	/**
+	 * @brief error of every slot of the register file, OK where the value is valid
+	*/
+	std::vector<AgisStatusCode> error_file;
+	size_t registers = 0;
+};
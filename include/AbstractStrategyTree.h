@@ -10,6 +10,8 @@
 #include "AgisErrors.h"
 #include "AgisPointers.h"
 #include "AgisStrategy.h"
+#include "AbstractStrategyProgram.h"
+#include "Asset/Asset.Core.h"
 
 namespace Agis {
 	class Asset;
@@ -90,9 +92,25 @@ public:
 	std::expected<double, AgisStatusCode> execute() override { AGIS_NOT_IMPL };
 	
 	/**
-	 * @brief pure virtual function that exexutes the asset lambda node on the given asset
+	 * @brief pure virtual function that exexutes the asset lambda node on the given asset. Takes
+	 * the asset by reference so the hot path never touches a shared_ptr ref count.
 	*/
-	virtual std::expected<double, AgisStatusCode> execute(std::shared_ptr<const Asset> const& asset) const = 0;
+	virtual std::expected<double, AgisStatusCode> execute(Asset const& asset) const = 0;
+
+	/**
+	 * @brief execute the asset lambda node on an owning asset pointer
+	*/
+	std::expected<double, AgisStatusCode> execute(std::shared_ptr<const Asset> const& asset) const {
+		return this->execute(*asset);
+	}
+
+	/**
+	 * @brief lower the node and its children into the program
+	 * @return register holding the node's value, NOT_IMPLEMENTED if the node wraps an opaque lambda
+	*/
+	virtual std::expected<size_t, AgisStatusCode> compile(AssetLambdaProgram& program) const {
+		return std::unexpected<AgisStatusCode>(AgisStatusCode::NOT_IMPLEMENTED);
+	}
 		
 	/**
 	 * @brief get the number of warmup periods required for the asset lambda node
@@ -142,7 +160,9 @@ public:
 
 
 	//============================================================================
-	std::expected<double, AgisStatusCode> execute(std::shared_ptr<const Asset> const& asset) const override;
+	using AbstractAssetLambdaNode::execute;
+	std::expected<double, AgisStatusCode> execute(Asset const& asset) const override;
+	std::expected<size_t, AgisStatusCode> compile(AssetLambdaProgram& program) const override;
 
 private:
 	std::string observer_name;
@@ -155,15 +175,29 @@ class AbstractAssetLambdaRead : public AbstractAssetLambdaNode {
 public:
 	//============================================================================
 	AbstractAssetLambdaRead(
-		std::function<std::expected<double, AgisStatusCode>(std::shared_ptr<const Asset> const&)> func_,
+		std::function<std::expected<double, AgisStatusCode>(Asset const&)> func_,
 		size_t warmup_ = 0
-	) : func(func_),
+	) : func(std::move(func_)),
 		AbstractAssetLambdaNode(AssetLambdaType::READ)
 	{
 		this->warmup = warmup_;
 	}
 
 
+	//============================================================================
+	AbstractAssetLambdaRead(
+		std::function<std::expected<double, AgisStatusCode>(std::shared_ptr<const Asset> const&)> func_,
+		size_t warmup_ = 0
+	) : AbstractAssetLambdaNode(AssetLambdaType::READ)
+	{
+		// wrap the owning lambda, the aliasing shared_ptr is non-owning so no ref count is taken
+		this->func = [f = std::move(func_)](Asset const& asset) {
+			return f(std::shared_ptr<const Asset>(std::shared_ptr<const Asset>(), &asset));
+		};
+		this->warmup = warmup_;
+	}
+
+
 	//============================================================================
 	AbstractAssetLambdaRead(std::string col, int index) : AbstractAssetLambdaNode(AssetLambdaType::READ)
 	{
@@ -183,19 +217,35 @@ public:
 	}
 
 
+	//============================================================================
+	/**
+	 * @brief resolved column index and row of a plain column read, nullopt before build or for
+	 * a read built from a user lambda
+	*/
+	std::optional<std::pair<size_t, int>> get_column_read() const noexcept {
+		if (!this->col_index) return std::nullopt;
+		return std::make_pair(*this->col_index, *this->index);
+	}
+
+
 	//============================================================================
 	void set_col_index_lambda(size_t col_index);
 
 
 	//============================================================================
-	std::expected<double, AgisStatusCode> execute(std::shared_ptr<const Asset> const& asset) const override {
-		return this->func(asset);
-	};
+	using AbstractAssetLambdaNode::execute;
+	std::expected<double, AgisStatusCode> execute(Asset const& asset) const override;
+	std::expected<size_t, AgisStatusCode> compile(AssetLambdaProgram& program) const override;
 
 private:
 	std::optional<std::string> col;
 	std::optional<int> index;
-	std::function<std::expected<double, AgisStatusCode>(std::shared_ptr<const Asset> const&)> func;
+
+	/**
+	 * @brief column index resolved at build, column reads skip the type erased func
+	*/
+	std::optional<size_t> col_index;
+	std::function<std::expected<double, AgisStatusCode>(Asset const&)> func;
 };
 
 
@@ -211,7 +261,9 @@ public:
 	);
 
 	//============================================================================
-	std::expected<double, AgisStatusCode> execute(std::shared_ptr<const Asset> const& asset) const override;
+	using AbstractAssetLambdaNode::execute;
+	std::expected<double, AgisStatusCode> execute(Asset const& asset) const override;
+	std::expected<size_t, AgisStatusCode> compile(AssetLambdaProgram& program) const override;
 
 private:
 	AgisLogicalOperation logical_compare;
@@ -228,10 +280,12 @@ public:
 	AbstractAssetLambdaOpp(
 		std::unique_ptr<AbstractAssetLambdaNode> left_node_,
 		std::unique_ptr<AbstractAssetLambdaRead> right_read_,
-		AgisOperation opperation_
+		AgisOperation opperation_,
+		std::optional<AgisOpperationType> opperation_type_ = std::nullopt
 	) : left_node(std::move(left_node_)),
 		right_read(std::move(right_read_)),
 		opperation(opperation_),
+		opperation_type(opperation_type_),
 		AbstractAssetLambdaNode(AssetLambdaType::OPP)
 	{
 		this->warmup = this->right_read->get_warmup();
@@ -294,7 +348,8 @@ public:
 
 
 	//============================================================================
-	std::expected<double, AgisStatusCode> execute(std::shared_ptr<const Asset> const& asset) const override {
+	using AbstractAssetLambdaNode::execute;
+	std::expected<double, AgisStatusCode> execute(Asset const& asset) const override {
 		// check if right opp is null or nan
 		auto res = right_read->execute(asset);
 		if (!res.has_value() || std::isnan(res.value())) return res;
@@ -310,10 +365,30 @@ public:
 		return opperation(left_res.value(), res.value());
 	}
 
+	//============================================================================
+	std::expected<size_t, AgisStatusCode> compile(AssetLambdaProgram& program) const override;
+
+
+	//============================================================================
+	/**
+	 * @brief column index and row if the whole opp is an INIT of a single column read, i.e. its
+	 * value is the column value itself
+	*/
+	std::optional<std::pair<size_t, int>> get_column_read() const noexcept {
+		if (this->left_node || this->opperation_type != AgisOpperationType::INIT) return std::nullopt;
+		return this->right_read->get_column_read();
+	}
+
 private:
 	std::unique_ptr<AbstractAssetLambdaNode> left_node = nullptr;
 	NonNullUniquePtr<AbstractAssetLambdaRead> right_read;
 	AgisOperation opperation;
+
+	/**
+	 * @brief type of the opperation if it was created from one, a user supplied AgisOperation
+	 * can not be compiled
+	*/
+	std::optional<AgisOpperationType> opperation_type;
 };
 
 
@@ -433,7 +508,7 @@ public:
 		// extract exchange from node, copy asset pointers into the node
 		this->exchange = exchange_node->evaluate();
 		for (auto& asset : this->exchange->get_assets()) {
-			this->assets.push_back(asset);
+			this->assets.emplace_back(asset->get_asset_index(), asset.get());
 		}
 
 		// for all read opps get size_t col index and set lambda func
@@ -447,6 +522,18 @@ public:
 		);
 		// set the minimum warmup for all opps
 		this->warmup = this->asset_lambda_op->get_warmup();
+		// a graph that only reads a column is gathered straight from the exchange
+		this->column_read = this->asset_lambda_op->get_column_read();
+		// lower the lambda graph to a flat program that propagates values and errors as the nodes do.
+		// Graphs holding opaque lambdas stay interpreted and keep the reason in compile_status.
+		AssetLambdaProgram program_;
+		auto compiled = this->asset_lambda_op->compile(program_);
+		if (compiled.has_value()) {
+			this->program = std::move(program_);
+		}
+		else {
+			this->compile_status = compiled.error();
+		}
 	}
 
 	//============================================================================
@@ -476,17 +563,104 @@ public:
 	*/
 	AGIS_API void apply_asset_index_filter(std::vector<size_t> const& index_keep);
 
+	/**
+	 * @brief only keep assets whose current value of a column is within the range. If the exchange
+	 * has built zone maps for the column, an asset whose current block lies entirely outside the range
+	 * is not looked at again until the next block that could match, and blocks entirely inside with
+	 * no missing values pass without a read.
+	 * @param col name of the column to filter on
+	 * @param range range the current value must be within
+	*/
+	AGIS_API AgisResult<bool> set_zone_filter(std::string const& col, AssetFilterRange range);
+
+
+	/**
+	 * @brief is the asset lambda graph executed as a compiled program
+	*/
+	bool is_compiled() const noexcept { return this->program.has_value(); }
+
+	/**
+	 * @brief why the graph could not be compiled, NOT_IMPLEMENTED for a graph holding a user
+	 * lambda. OK if it compiled.
+	*/
+	AgisStatusCode get_compile_status() const noexcept { return this->compile_status; }
+
 
 	//============================================================================
 	AGIS_API std::expected<bool, AgisStatusCode> execute() override;
 
 private:
+	/**
+	 * @brief evaluate the asset lambda graph one asset at a time and write the view
+	*/
+	std::expected<bool, AgisStatusCode> execute_interpreted();
+
+	/**
+	 * @brief gather the column of a plain column read graph into the reusable buffer and build the
+	 * view of the live assets from it
+	*/
+	std::expected<bool, AgisStatusCode> execute_column_read();
+
+	/**
+	 * @brief leave the column read path, filters are applied per asset on a view aligned with assets
+	*/
+	void reset_view();
+
+	/**
+	 * @brief evaluate the compiled program across all assets at once into values
+	*/
+	std::expected<bool, AgisStatusCode> run_program();
+
+	/**
+	 * @brief evaluate the compiled program across all assets at once and write the view
+	*/
+	std::expected<bool, AgisStatusCode> execute_program();
+
+	/**
+	 * @brief zone decision of an asset over a run of its rows [from, until). EXCLUDE skips the asset
+	 * until the next block __seek_zone finds could match, INCLUDE passes a block inside the range
+	 * with no missing values, READ checks the value on every row.
+	*/
+	enum class ZoneDecision : uint8_t { READ, EXCLUDE, INCLUDE };
+	struct ZoneState {
+		size_t from = 0;
+		size_t until = 0;
+		ZoneDecision decision = ZoneDecision::READ;
+	};
+
+	/**
+	 * @brief does asset i of the node pass the zone filter at its current row
+	*/
+	bool passes_zone_filter(size_t i, Asset const& asset) noexcept;
+
+	/**
+	 * @brief look up the zone of the asset's block containing row
+	*/
+	ZoneState zone_decision(Asset const& asset, size_t row) const noexcept;
+
 	ExchangeView exchange_view;
 	const Exchange* exchange;
-	std::vector<AssetPtr> assets;
+	std::vector<AssetHandle> assets;
+	std::optional<std::pair<size_t, AssetFilterRange>> zone_filter = std::nullopt;
+	std::vector<ZoneState> zone_states;
 	NonNullSharedPtr<AbstractExchangeNode> exchange_node;
 	NonNullUniquePtr<AbstractAssetLambdaOpp> asset_lambda_op;
 	size_t warmup = 0;
+
+	/**
+	 * @brief column index and row resolved at build if the graph is a plain column read and no
+	 * filter has been applied, with the gather buffer reused every step
+	*/
+	std::optional<std::pair<size_t, int>> column_read = std::nullopt;
+	ExchangeColumnBuffer column_buffer;
+
+	/**
+	 * @brief compiled form of asset_lambda_op with its per asset mask and output buffers
+	*/
+	std::optional<AssetLambdaProgram> program = std::nullopt;
+	AgisStatusCode compile_status = AgisStatusCode::OK;
+	std::vector<char> active;
+	std::vector<double> values;
 };
 
 
@@ -528,13 +702,56 @@ private:
 };
 
 
+//============================================================================
+/**
+ * @brief rank, demean, z-score or winsorise a column across the exchange's visible assets, then
+ * select the top/bottom N of the transformed values. The transform is read from the exchange's
+ * per step cache so graphs transforming the same column share one computation.
+*/
+class AbstractCrossSectionNode : public ValueReturningStatementNode<std::expected<ExchangeView, AgisStatusCode>> {
+public:
+	//============================================================================
+	AbstractCrossSectionNode(
+		std::shared_ptr<AbstractExchangeNode> exchange_node_,
+		std::string col_,
+		CrossSectionTransform transform_,
+		double param_,
+		int row_,
+		int N_,
+		ExchangeQueryType query_type_
+	);
+
+
+	//============================================================================
+	size_t get_warmup() const override {
+		return this->warmup;
+	}
+
+
+	//============================================================================
+	AGIS_API std::expected<ExchangeView, AgisStatusCode> execute() override;
+
+private:
+	NonNullSharedPtr<AbstractExchangeNode> exchange_node;
+	const Exchange* exchange;
+	std::string col;
+	CrossSectionTransform transform;
+	double param;
+	int row;
+	int N;
+	ExchangeQueryType query_type;
+	size_t warmup = 0;
+};
+
+
 //============================================================================
 class AbstractGenAllocationNode : public ValueReturningStatementNode<std::expected<ExchangeView, AgisStatusCode>> {
 public:
 	//============================================================================
 	using SourceNode = std::variant<
 		std::unique_ptr<AbstractTableViewNode>,
-		std::unique_ptr<AbstractSortNode>>;
+		std::unique_ptr<AbstractSortNode>,
+		std::unique_ptr<AbstractCrossSectionNode>>;
 
 	AGIS_API ~AbstractGenAllocationNode() = default;
 	AbstractGenAllocationNode(
@@ -558,6 +775,9 @@ public:
 			else if constexpr (std::is_same_v<std::decay_t<decltype(option)>, std::unique_ptr<AbstractSortNode>>) {
 				return option->execute();
 			}
+			else if constexpr (std::is_same_v<std::decay_t<decltype(option)>, std::unique_ptr<AbstractCrossSectionNode>>) {
+				return option->execute();
+			}
 			else {
 				return std::unexpected<AgisStatusCode>(AgisStatusCode::INVALID_CONFIGURATION);
 			}
@@ -574,6 +794,9 @@ public:
 			else if constexpr (std::is_same_v<std::decay_t<decltype(option)>, std::unique_ptr<AbstractSortNode>>) {
 				return option->get_warmup();
 			}
+			else if constexpr (std::is_same_v<std::decay_t<decltype(option)>, std::unique_ptr<AbstractCrossSectionNode>>) {
+				return option->get_warmup();
+			}
 			else {
 				return std::unexpected<AgisStatusCode>(AgisStatusCode::INVALID_CONFIGURATION);
 			}
@@ -636,7 +859,7 @@ public:
 	std::expected<ExchangeView*, AgisStatusCode> apply_vol_target(ExchangeView* v) {
 		// apply a given vol target to the exchange view if it is set.
 		if (!this->vol_target.has_value()) return v;
-		auto res = v->vol_target(this->vol_target.value());
+		auto res = v->vol_target(this->vol_target.value(), this->vol_target_covariance);
 		if (res.is_exception()) {
 			return std::unexpected<AgisStatusCode>(AgisStatusCode::INVALID_CONFIGURATION);
 		}
@@ -664,6 +887,7 @@ private:
 	double target;
 	std::optional<double> ev_opp_param;
 	std::optional<double> vol_target;
+	AgisCovarianceBlock vol_target_covariance;
 };
 
 
@@ -722,6 +946,14 @@ private:
 //============================================================================
 AGIS_API std::unique_ptr<AbstractAssetLambdaRead> create_asset_lambda_read(std::string col, int index);
 
+
+//============================================================================
+/**
+ * @brief create a node that reads the current result of an asset observer by its str_rep,
+ * i.e. "close_COL_ROL_MAX_20". The observer must be added to the exchange before the tree is built.
+*/
+AGIS_API std::unique_ptr<AbstractAssetLambdaNode> create_asset_observe(std::string observer_name);
+
 //============================================================================
 AGIS_API std::unique_ptr<AbstractAssetLambdaOpp> create_asset_lambda_opp(
 	std::unique_ptr<AbstractAssetLambdaNode>& left_node,
@@ -773,6 +1005,27 @@ AGIS_API std::unique_ptr<AbstractSortNode> create_sort_node(
 );
 
 
+//============================================================================
+/**
+ * @brief create a node transforming a column across the exchange's assets
+ * @param col name of the column to transform
+ * @param transform rank, demean, z-score or winsorise
+ * @param param tail quantile clipped by winsorise, must be in [0, 0.5). Ignored otherwise
+ * @param row row index to query (0, current) (-1, previous)
+ * @param N number of transformed values to keep, -1 keeps all
+ * @param query_type which N values to keep
+*/
+AGIS_API std::unique_ptr<AbstractCrossSectionNode> create_cross_section_node(
+	std::shared_ptr<AbstractExchangeNode>& exchange_node,
+	std::string col,
+	CrossSectionTransform transform,
+	double param,
+	int row,
+	int N,
+	ExchangeQueryType query_type
+);
+
+
 //============================================================================
 AGIS_API std::unique_ptr<AbstractGenAllocationNode> create_gen_alloc_node(
 	std::unique_ptr<AbstractSortNode>& sort_node,
@@ -791,6 +1044,15 @@ AGIS_API std::unique_ptr<AbstractGenAllocationNode> create_table_gen_alloc_node(
 );
 
 
+//============================================================================
+AGIS_API std::unique_ptr<AbstractGenAllocationNode> create_cross_section_gen_alloc_node(
+	std::unique_ptr<AbstractCrossSectionNode>& cross_section_node,
+	ExchangeViewOpp ev_opp_type,
+	double target,
+	std::optional<double> ev_opp_param
+);
+
+
 //============================================================================
 AGIS_API std::unique_ptr<AbstractStrategyAllocationNode> create_strategy_alloc_node(
 	AgisStrategy* strategy_,
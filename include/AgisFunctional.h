@@ -155,6 +155,35 @@ public:
         };
     }
 
+    /**
+     * @brief is the value within the range
+    */
+    AGIS_API bool contains(double value) const noexcept {
+        bool above = lowerInclusive_ ? value >= lowerBound_ : value > lowerBound_;
+        bool below = upperInclusive_ ? value <= upperBound_ : value < upperBound_;
+        return above && below;
+    }
+
+    /**
+     * @brief could any value in [lower, upper] be within the range. Used to test zone map blocks.
+    */
+    AGIS_API bool may_contain(double lower, double upper) const noexcept {
+        if (lower > upper) return false;
+        bool above = upperInclusive_ ? lower <= upperBound_ : lower < upperBound_;
+        bool below = lowerInclusive_ ? upper >= lowerBound_ : upper > lowerBound_;
+        return above && below;
+    }
+
+    /**
+     * @brief is every value in [lower, upper] within the range
+    */
+    AGIS_API bool contains_all(double lower, double upper) const noexcept {
+        return lower <= upper && this->contains(lower) && this->contains(upper);
+    }
+
+    double lower_bound() const noexcept { return this->lowerBound_; }
+    double upper_bound() const noexcept { return this->upperBound_; }
+
 
 private:
     double lowerBound_;
@@ -0,0 +1,233 @@
+#pragma once
+#ifdef AGISCORE_EXPORTS
+#define AGIS_API __declspec(dllexport)
+#else
+#define AGIS_API __declspec(dllimport)
+#endif
+#include <cmath>
+#include <limits>
+#include <span>
+#include <vector>
+
+
+namespace Agis
+{
+
+namespace Kernels
+{
+
+/**
+ * @brief does the current cpu support the AVX2 code paths. Checked once and cached, all kernels
+ * fall back to scalar loops when it does not.
+*/
+AGIS_API bool has_avx2() noexcept;
+
+
+//============================================================================
+/**
+ * @brief rolling sum over a fixed window. out[i] holds the sum of x[i-window+1, i], entries before
+ * the first full window are set to NaN. Window deltas are computed with vector loads and then
+ * accumulated with a compensated (Neumaier) scan so long series do not drift.
+ * @param x input series
+ * @param window size of the rolling window
+ * @param out output series, must be the same size as x
+*/
+AGIS_API void rolling_sum(
+	std::span<double const> x,
+	size_t window,
+	std::span<double> out
+) noexcept;
+
+
+//============================================================================
+/**
+ * @brief rolling sum of the element wise product of two series, out[i] = sum x[k]*y[k] over the window
+ * ending at i. Used for rolling sums of squares (x == y) and cross products.
+*/
+AGIS_API void rolling_cross_sum(
+	std::span<double const> x,
+	std::span<double const> y,
+	size_t window,
+	std::span<double> out
+) noexcept;
+
+
+//============================================================================
+/**
+ * @brief rolling mean over a fixed window, NaN before the first full window
+*/
+AGIS_API void rolling_mean(
+	std::span<double const> x,
+	size_t window,
+	std::span<double> out
+) noexcept;
+
+
+//============================================================================
+/**
+ * @brief rolling sample variance (ddof = 1) over a fixed window, NaN before the first full window.
+ * The series is shifted by its first value before accumulating to avoid cancellation when the
+ * mean is large relative to the spread (i.e. prices).
+*/
+AGIS_API void rolling_variance(
+	std::span<double const> x,
+	size_t window,
+	std::span<double> out
+) noexcept;
+
+
+//============================================================================
+/**
+ * @brief rolling mean and sample variance in a single pass over the data
+*/
+AGIS_API void rolling_moments(
+	std::span<double const> x,
+	size_t window,
+	std::span<double> mean_out,
+	std::span<double> var_out
+) noexcept;
+
+
+//============================================================================
+/**
+ * @brief rolling z-score (x - mean) / std over a fixed window. NaN before the first full window
+ * or when the window has no variance.
+*/
+AGIS_API void rolling_zscore(
+	std::span<double const> x,
+	size_t window,
+	std::span<double> out
+) noexcept;
+
+
+//============================================================================
+/**
+ * @brief simple returns of a price series, out[0] = 0 and out[i] = x[i] / x[i-1] - 1.
+ * out must not alias x.
+*/
+AGIS_API void pct_change(
+	std::span<double const> x,
+	std::span<double> out
+) noexcept;
+
+
+//============================================================================
+/**
+ * @brief rolling beta of x against market, cov(x, market) / var(market) over a fixed window.
+ * Both series are shifted by their first value and the window sums are accumulated with the same
+ * compensated scan as rolling_moments. NaN before the first full window or when the market has
+ * no variance.
+*/
+AGIS_API void rolling_beta(
+	std::span<double const> x,
+	std::span<double const> market,
+	size_t window,
+	std::span<double> out
+) noexcept;
+
+
+//============================================================================
+/**
+ * @brief first and second moments of one or two series. Updated with Welford's recurrence and
+ * combined with Chan's parallel formula, so partial results from vector lanes, chunks or
+ * separate series can be merged without losing precision.
+*/
+struct Moments
+{
+	size_t n = 0;
+	double mean_x = 0.0;
+	double mean_y = 0.0;
+	double m2_x = 0.0;
+	double m2_y = 0.0;
+	double c_xy = 0.0;
+
+	inline void add(double x, double y = 0.0) noexcept {
+		n++;
+		double inv = 1.0 / static_cast<double>(n);
+		double dx = x - mean_x;
+		double dy = y - mean_y;
+		mean_x += dx * inv;
+		mean_y += dy * inv;
+		m2_x += dx * (x - mean_x);
+		m2_y += dy * (y - mean_y);
+		c_xy += dx * (y - mean_y);
+	}
+
+	inline void merge(Moments const& other) noexcept {
+		if (!other.n) return;
+		if (!n) { *this = other; return; }
+		double na = static_cast<double>(n);
+		double nb = static_cast<double>(other.n);
+		double total = na + nb;
+		double dx = other.mean_x - mean_x;
+		double dy = other.mean_y - mean_y;
+		double w = na * nb / total;
+		mean_x += dx * nb / total;
+		mean_y += dy * nb / total;
+		m2_x += other.m2_x + dx * dx * w;
+		m2_y += other.m2_y + dy * dy * w;
+		c_xy += other.c_xy + dx * dy * w;
+		n += other.n;
+	}
+
+	inline double variance_x(size_t ddof = 1) const noexcept { return n > ddof ? m2_x / static_cast<double>(n - ddof) : std::numeric_limits<double>::quiet_NaN(); }
+	inline double variance_y(size_t ddof = 1) const noexcept { return n > ddof ? m2_y / static_cast<double>(n - ddof) : std::numeric_limits<double>::quiet_NaN(); }
+	inline double covariance(size_t ddof = 1) const noexcept { return n > ddof ? c_xy / static_cast<double>(n - ddof) : std::numeric_limits<double>::quiet_NaN(); }
+	inline double correlation() const noexcept { return c_xy / std::sqrt(m2_x * m2_y); }
+
+	/**
+	 * @brief regression slope of x on y, cov(x, y) / var(y). y is the benchmark series.
+	*/
+	inline double beta() const noexcept { return c_xy / m2_y; }
+};
+
+
+//============================================================================
+/**
+ * @brief single pass moments of a series. AVX2 builds run four interleaved Welford accumulators
+ * and merge the lanes at the end, the tail is added with the scalar recurrence.
+*/
+AGIS_API Moments moments(std::span<double const> x) noexcept;
+
+/**
+ * @brief single pass joint moments of two series of the same length
+*/
+AGIS_API Moments moments(std::span<double const> x, std::span<double const> y) noexcept;
+
+
+//============================================================================
+AGIS_API double mean(std::span<double const> x) noexcept;
+AGIS_API double variance(std::span<double const> x, size_t ddof = 1) noexcept;
+AGIS_API double covariance(std::span<double const> x, std::span<double const> y, size_t ddof = 1) noexcept;
+AGIS_API double correlation(std::span<double const> x, std::span<double const> y) noexcept;
+
+/**
+ * @brief beta of x against the benchmark series market, cov(x, market) / var(market)
+*/
+AGIS_API double beta(std::span<double const> x, std::span<double const> market) noexcept;
+
+
+//============================================================================
+/**
+ * @brief moments of many series at once, out[i] holds the moments of series[i]
+*/
+AGIS_API void batch_moments(
+	std::span<std::span<double const> const> series,
+	std::span<Moments> out
+) noexcept;
+
+
+//============================================================================
+/**
+ * @brief beta of many series against one benchmark, out[i] = beta(series[i], market).
+ * Each series must be the same length as market.
+*/
+AGIS_API void batch_beta(
+	std::span<std::span<double const> const> series,
+	std::span<double const> market,
+	std::span<double> out
+) noexcept;
+
+}
+
+}
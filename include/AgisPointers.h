@@ -9,6 +9,10 @@
 #include <mutex>
 #include <stdexcept>
 #include <memory>
+#include <atomic>
+#include <bit>
+#include <vector>
+#include <cstdint>
 
 #define LOCK_GUARD _mutex.lock();
 #define UNLOCK_GUARD _mutex.unlock();
@@ -228,6 +232,79 @@ private:
     mutable std::mutex mutex_;
 };
 
+/**
+ * @brief fixed size bitmap backed by atomic 64 bit words. Used to publish per index flags
+ * (i.e. which assets are still live) without locking the container the indices refer to.
+*/
+class AtomicBitmap {
+public:
+    AtomicBitmap() = default;
+    explicit AtomicBitmap(size_t n, bool value = false) { this->resize(n, value); }
+
+    void resize(size_t n, bool value = false) {
+        this->bits = n;
+        this->words = std::vector<std::atomic<uint64_t>>((n + 63) / 64);
+        this->fill(value);
+    }
+
+    void fill(bool value) noexcept {
+        for (auto& word : this->words) {
+            word.store(value ? ~uint64_t(0) : uint64_t(0), std::memory_order_relaxed);
+        }
+        // keep bits past the end cleared so count and scans stay exact
+        if (value && (this->bits & 63)) {
+            this->words.back().store((uint64_t(1) << (this->bits & 63)) - 1, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    inline void set(size_t i) noexcept {
+        this->words[i >> 6].fetch_or(uint64_t(1) << (i & 63), std::memory_order_release);
+    }
+
+    inline void reset(size_t i) noexcept {
+        this->words[i >> 6].fetch_and(~(uint64_t(1) << (i & 63)), std::memory_order_release);
+    }
+
+    inline bool test(size_t i) const noexcept {
+        if (i >= this->bits) return false;
+        return (this->words[i >> 6].load(std::memory_order_acquire) >> (i & 63)) & 1;
+    }
+
+    size_t size() const noexcept { return this->bits; }
+
+    size_t count() const noexcept {
+        size_t n = 0;
+        for (auto& word : this->words) n += std::popcount(word.load(std::memory_order_acquire));
+        return n;
+    }
+
+    /**
+     * @brief call func(i) for every set bit i in [begin, end)
+    */
+    template <typename Func>
+    void for_each_set(size_t begin, size_t end, Func&& func) const {
+        if (end > this->bits) end = this->bits;
+        if (begin >= end) return;
+        size_t first_word = begin >> 6;
+        size_t last_word = (end - 1) >> 6;
+        for (size_t w = first_word; w <= last_word; w++) {
+            uint64_t word = this->words[w].load(std::memory_order_acquire);
+            if (w == first_word) word &= ~uint64_t(0) << (begin & 63);
+            if (w == last_word && (end & 63)) word &= (uint64_t(1) << (end & 63)) - 1;
+            while (word) {
+                func((w << 6) + static_cast<size_t>(std::countr_zero(word)));
+                word &= word - 1;
+            }
+        }
+    }
+
+private:
+    std::vector<std::atomic<uint64_t>> words;
+    size_t bits = 0;
+};
+
+
 template<typename T>
 class AGIS_API AgisMatrix {
 public:
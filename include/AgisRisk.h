@@ -8,12 +8,14 @@
 #include <span>
 #include <optional>
 #include <expected>
+#include <mutex>
+#include <limits>
 #include <Eigen/Dense>
 
 #include "AgisException.h"
 
 namespace Agis {
-	class IncrementalCovariance;
+	class Asset;
 }
 
 using namespace Eigen;
@@ -27,57 +29,240 @@ class AgisStrategy;
 class ExchangeMap;
 
 /**
- * @brief Container for holding the covariance matrix for all assets listed on an exchange. It contains 
- * a matrix of covariances between all assets, as well as a vector of vectors of incremental covariance structs
- * used to update the cov matrix on exchange step forward.
+ * @brief estimator used by the covariance matrix. SAMPLE is the pairwise sample covariance,
+ * LEDOIT_WOLF shrinks it towards a scaled identity and FACTOR stores B*F*B' + D from either
+ * the top k principal components of the return window or user supplied factor loadings.
+*/
+enum class AGIS_API CovarianceEstimator {
+	SAMPLE,
+	LEDOIT_WOLF,
+	FACTOR,
+};
+
+AGIS_API const char* CovarianceEstimatorToString(CovarianceEstimator estimator);
+AGIS_API std::expected<CovarianceEstimator, AgisException> StringToCovarianceEstimator(std::string const& estimator);
+
+
+/**
+ * @brief covariance sub-block held by its caller. Each holder (a strategy's tracers, an allocation
+ * node) keeps its own so callers with different holdings do not evict each other. The block is
+ * reused while the indices and the matrix's generation are unchanged.
+*/
+struct AgisCovarianceBlock
+{
+	std::vector<size_t> indices;
+	MatrixXd block;
+	size_t generation = std::numeric_limits<size_t>::max();
+};
+
+
+/**
+ * @brief Covariance matrix of the returns of all assets in the exchange map. Every step_size steps
+ * the return of each asset since the last sample is written into a dense (lookback x N) ring buffer.
+ * Nothing else is done on step, the window sums are brought up to date with a single rank-p
+ * update of the pending samples (or recomputed from the window) the first time a consumer reads
+ * the matrix after a sample, and the result is cached until the next sample. Missing bars are
+ * masked out so each entry is the covariance over the samples where both assets have a return.
 */
 struct AgisCovarianceMatrix
 {
 	AgisCovarianceMatrix(ExchangeMap* exchange_map, size_t lookback = 252, size_t step_size = 1);
 	
 	// Overload for accessing the covariance matrix
-	double operator()(size_t i, size_t j) const noexcept {
-		return covariance_matrix(i,j);
-	}
+	double operator()(size_t i, size_t j) const noexcept;
+
+	/**
+	 * @brief variance of asset i, works for both the dense and the factored form
+	*/
+	double variance(size_t i) const noexcept { return (*this)(i, i); }
+
+	/**
+	 * @brief w' * Sigma * w. O(N^2) for the dense estimators and O(N*k) for the factor model
+	 * @param weights portfolio weights of size N
+	*/
+	double portfolio_variance(VectorXd const& weights) const noexcept;
+
+	/**
+	 * @brief w' * Sigma * w for a portfolio holding only the given assets, evaluated on the k x k
+	 * sub-block of the held assets
+	 * @param indices asset indices held
+	 * @param weights weights of the held assets, same order as indices
+	 * @param cache the caller's block, reused while the indices and the window are unchanged
+	*/
+	double portfolio_variance(
+		std::span<size_t const> indices,
+		VectorXd const& weights,
+		AgisCovarianceBlock& cache
+	) const noexcept;
+
+	/**
+	 * @brief covariance sub-block of the given assets. For the sample estimator it is computed
+	 * directly from the return window in O(lookback * k^2) without touching the full matrix, the
+	 * factor model builds it from the held rows of the loadings. The block is built outside the
+	 * matrix's mutex so holders on different threads do not serialise on each other.
+	*/
+	MatrixXd get_sub_matrix(std::span<size_t const> indices) const noexcept;
+
+	/**
+	 * @brief bring the caller's block up to date with the given indices and the current window
+	*/
+	void refresh_sub_block(std::span<size_t const> indices, AgisCovarianceBlock& cache) const noexcept;
+
+	/**
+	 * @brief incremented on every sample, reset and estimator change, blocks built at an older
+	 * generation are stale
+	*/
+	size_t get_generation() const noexcept { return this->generation; }
+
+	/**
+	 * @brief set the estimator, clears the window. The factor estimator does not keep the dense
+	 * N x N matrices, get_eigen_matrix is empty and the accessors above must be used instead.
+	 * @param estimator estimator to use
+	 * @param factor_count number of principal components used by the factor estimator
+	*/
+	std::expected<bool, AgisException> set_estimator(CovarianceEstimator estimator, size_t factor_count = 0) noexcept;
 
 	/**
-	 * @brief enable the covariance matrix tracing by adding observers to all assets
+	 * @brief use fixed factor loadings (N x k) for the factor estimator. The factor covariance
+	 * and specific variances are still estimated from the return window.
 	*/
-	void set_asset_observers() noexcept;
+	std::expected<bool, AgisException> set_factor_loadings(MatrixXd loadings) noexcept;
+
+	CovarianceEstimator get_estimator() const noexcept { return this->estimator; }
+	bool is_factored() const noexcept { return this->estimator == CovarianceEstimator::FACTOR; }
+	size_t get_factor_count() const noexcept { return this->factor_count; }
+	bool has_user_loadings() const noexcept { return this->user_loadings; }
+	auto const& get_factor_loadings() const noexcept { this->ensure_current(); return this->factor_loadings; }
+	auto const& get_factor_covariance() const noexcept { this->ensure_current(); return this->factor_covariance; }
+	auto const& get_specific_variance() const noexcept { this->ensure_current(); return this->specific_variance; }
 
 	/**
-	 * @brief disable the covariance matrix tracing by removing all observers from the assets
+	 * @brief enable or disable tracking of the covariance matrix on exchange map step
 	*/
-	void clear_observers() noexcept;
+	void set_enabled(bool enabled) noexcept { this->enabled = enabled; }
+	bool is_enabled() const noexcept { return this->enabled; }
+
+	/**
+	 * @brief called by the exchange map after all exchanges have stepped, samples the asset
+	 * returns every step_size steps and updates the covariance matrix
+	*/
+	void step() noexcept;
+
+	/**
+	 * @brief clear the return window and the covariance matrix
+	*/
+	void reset() noexcept;
 
 	/**
 	 * @brief get the underlying eigen matrix of covariance values
 	 * @return 
 	*/
-	auto const & get_eigen_matrix() const noexcept {return this->covariance_matrix; }
+	auto const & get_eigen_matrix() const noexcept { this->ensure_current(); return this->covariance_matrix; }
 
 	size_t get_step_size() const noexcept { return this->step_size; }
 	size_t get_lookback() const noexcept { return this->lookback; }
+	size_t get_asset_count() const noexcept { return this->tracked.size(); }
 
 private:
 	/**
-	 * @brief container for incremental covariance structs used to update the
-	 * covariance matrix on exchange step forward. Not only lower diagonal is stored, use symmetry to fill rest
+	 * @brief materialise the estimator if a sample has been taken since it was last read
+	*/
+	void ensure_current() const noexcept;
+
+	/**
+	 * @brief apply the samples added and removed since the last read to the window sums as one
+	 * rank-p update, falls back to recompute_sums once a full window is pending
+	*/
+	void apply_pending() const noexcept;
+
+	/**
+	 * @brief build the sub-block of the given assets. Only reads the window and the fit, which
+	 * are not written between samples once ensure_current has run.
+	*/
+	void compute_sub_block(std::span<size_t const> indices, MatrixXd& block) const noexcept;
+
+	/**
+	 * @brief recompute the window sums from the ring buffer to discard accumulated rounding error
+	*/
+	void recompute_sums() const noexcept;
+
+	/**
+	 * @brief pairwise covariance from the window sums, 0 where fewer than 2 common samples exist
+	*/
+	void materialise() const noexcept;
+
+	/**
+	 * @brief returns in the window with each column demeaned over its present samples, rows
+	 * with no sample for an asset are 0
 	*/
-	std::vector<std::shared_ptr<IncrementalCovariance>> incremental_covariance_matrix;
+	MatrixXd centered_window() const noexcept;
+
+	/**
+	 * @brief shrink the sample covariance towards mu * I with the Ledoit-Wolf intensity
+	*/
+	void apply_shrinkage() const noexcept;
+
+	/**
+	 * @brief estimate the loadings (PCA only), factor covariance and specific variances
+	*/
+	void fit_factor_model() const noexcept;
 
 	/**
 	 * @brief Main covariance matrix containing the covariance between all assets in the exchange map
 	*/
-	MatrixXd covariance_matrix;
+	mutable MatrixXd covariance_matrix;
+
+	/**
+	 * @brief ring buffer of sampled returns (0 where missing) and the matching 0/1 mask
+	*/
+	MatrixXd returns_window;
+	MatrixXd mask_window;
+
+	/**
+	 * @brief window sums over the samples where both i and j are present: sum r_i r_j,
+	 * sum r_i (not symmetric) and the sample count
+	*/
+	mutable MatrixXd sum_xy;
+	mutable MatrixXd sum_x;
+	mutable MatrixXd count;
+
+	/**
+	 * @brief samples that fell out of the window since the last read, needed to remove them
+	 * from the sums lazily
+	*/
+	mutable MatrixXd removed_returns;
+	mutable MatrixXd removed_mask;
+	mutable size_t pending = 0;
+	mutable size_t pending_removed = 0;
+	mutable size_t samples_since_recompute = 0;
+	mutable bool dirty = false;
+	mutable std::mutex _mutex;
+
+	size_t generation = 0;
+
+	VectorXd last_price;
+	std::vector<char> tracked;
+
+	CovarianceEstimator estimator = CovarianceEstimator::SAMPLE;
+	size_t factor_count = 0;
+	bool user_loadings = false;
+
+	/**
+	 * @brief factored form Sigma = B * F * B' + diag(D)
+	*/
+	mutable MatrixXd factor_loadings;
+	mutable MatrixXd factor_covariance;
+	mutable VectorXd specific_variance;
 
 	ExchangeMap* exchange_map = nullptr;
 
-	bool built = false;
+	bool enabled = false;
 
 	size_t lookback = 0;
 	size_t step_size = 1;
-
+	size_t step_count = 0;
+	size_t samples = 0;
+	size_t head = 0;
 };
 
 
@@ -126,6 +311,28 @@ AGIS_API std::expected<double, AgisException> calculate_portfolio_volatility(
 );
 
 
+/**
+ * @brief annualised portfolio volatility using either the dense or the factored covariance
+*/
+AGIS_API std::expected<double, AgisException> calculate_portfolio_volatility(
+	VectorXd const& portfolio_weights,
+	AgisCovarianceMatrix const& covariance_matrix
+);
+
+
+/**
+ * @brief annualised volatility of a portfolio holding only the given assets, only the held
+ * sub-block of the covariance matrix is used
+ * @param cache the caller's covariance block
+*/
+AGIS_API std::expected<double, AgisException> calculate_portfolio_volatility(
+	std::span<size_t const> asset_indices,
+	VectorXd const& portfolio_weights,
+	AgisCovarianceMatrix const& covariance_matrix,
+	AgisCovarianceBlock& cache
+);
+
+
 struct AgisRiskStruct
 {
 	AgisRiskStruct() {};
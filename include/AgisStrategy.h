@@ -412,6 +412,11 @@ protected:
 	*/
 	AllocTypeTarget alloc_type_target = AllocTypeTarget::LEVERAGE;
 
+	/**
+	 * @brief covariance sub-block of the last allocation vol targeted by the strategy
+	*/
+	AgisCovarianceBlock allocation_covariance;
+
 	/// <summary>
 	/// Mapping between asset_index and trade owned by the strategy
 	/// </summary>
@@ -5,6 +5,7 @@
 #define AGIS_API __declspec(dllimport)
 #endif
 #include "AgisErrors.h"
+#include "AgisRisk.h"
 #include <bitset>
 #include <cstdint>
 #include <atomic>
@@ -103,6 +104,11 @@ private:
     std::atomic<double> net_leverage_ratio = 0;
     std::atomic<double> portfolio_volatility = 0;
 
+    /**
+     * @brief covariance sub-block of the held assets, kept between steps while holdings are unchanged
+    */
+    AgisCovarianceBlock holdings_covariance;
+
     AgisStrategy* strategy;
     std::bitset<MAX> value_{ 0 };
 
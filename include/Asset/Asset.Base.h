@@ -41,9 +41,24 @@ namespace Agis
 
 class Asset;
 class AssetObserver;
+class DataFrameColObserver;
 
 using AssetPtr = std::shared_ptr<Asset>;
 
+
+/**
+ * @brief per block min and max of a single column, NaN values are ignored. Lets filters skip an
+ * asset, and scans skip whole blocks of rows, when the block range cannot satisfy the filter.
+ * has_nan marks the blocks holding a missing value, which no range contains.
+*/
+struct ZoneMap
+{
+    size_t block_size = 0;
+    std::vector<double> min;
+    std::vector<double> max;
+    std::vector<char> has_nan;
+};
+
 class  Asset
 {
     friend class Exchange;
@@ -101,7 +116,7 @@ public:
     /**
      * @brief remove all observers from the asset
     */
-    void clear_observers() { this->observers.clear(); }
+    void clear_observers() { this->observers.clear(); this->observer_dispatch_valid = false; }
 
     /// <summary>
     /// Takes an asset and returns a vector of NLV values representing the result of 
@@ -144,13 +159,40 @@ public:
     AGIS_API std::span<const double> const __get_column(std::string const& column_name) const;
     AGIS_API std::span<const long long> const __get_dt_index(bool adjust_for_warmup = true) const;
     AGIS_API std::vector<std::string> __get_dt_index_str(bool adjust_for_warmup = true) const;
+
+    /**
+     * @brief build the zone map of a column, replaces any existing map for that column
+     * @param column_index index of the column
+     * @param block_size number of rows summarised by each zone
+    */
+    AGIS_API AgisResult<bool> __build_zone_map(size_t column_index, size_t block_size = 256);
+
+    /**
+     * @brief min and max of the zone containing row, nullopt if the column has no zone map
+    */
+    AGIS_API std::optional<std::pair<double, double>> __get_zone(size_t column_index, size_t row) const noexcept;
+
+    /**
+     * @brief zone map of a column, nullptr if none has been built
+    */
+    AGIS_API ZoneMap const* __get_zone_map(size_t column_index) const noexcept;
+
+    /**
+     * @brief first row at or after row whose zone could hold a value in [lower, upper]. Returns the
+     * row count if no later zone can, and row itself if the column has no zone map.
+    */
+    AGIS_API size_t __seek_zone(size_t column_index, size_t row, double lower, double upper) const noexcept;
     size_t __get_index(bool offset = true) const { return offset ? this->asset_index : this->asset_index - this->exchange_offset; }
     bool __get_is_aligned() const { return this->__is_aligned; }
 
 
     bool __contains_column(std::string const& col) { return this->headers.count(col) > 0; }
     bool __valid_row(int n)const { return abs(n) <= (this->current_index - 1); }
-    void __set_warmup(size_t warmup_) { if (this->warmup < warmup_) this->warmup = warmup_; }
+    void __set_warmup(size_t warmup_) {
+        if (this->warmup >= warmup_) return;
+        this->warmup = warmup_;
+        this->invalidate_observers();
+    }
     void __set_unit_multiplier(size_t unit_multiplier_) noexcept { this->unit_multiplier = unit_multiplier_; }
     void __set_in_exchange_view(bool x) { this->__in_exchange_view = x; }
     bool __is_valid_time(long long& datetime);
@@ -225,6 +267,17 @@ protected:
 
     AGIS_API inline void __set_alignment(bool is_aligned_) { this->__is_aligned = is_aligned_; }
     bool __set_beta(AssetPtr market_asset, size_t lookback);
+
+    /**
+     * @brief compute the rolling beta against market data fetched by the caller. The first row is
+     * located with a binary search, the rest by walking both datetime indexes forward together.
+     * Fails if the market index does not contain every datetime of this asset.
+    */
+    bool __set_beta(
+        std::span<long long const> market_dt_index,
+        std::span<double const> market_close,
+        size_t lookback
+    );
     bool __set_beta(std::vector<double> beta_column);
     void __set_index(size_t index_) { this->asset_index = index_; }
     void __set_exchange_offset(size_t offset) { this->exchange_offset = offset; }
@@ -283,13 +336,32 @@ private:
     */
     ankerl::unordered_dense::map<std::string, AssetObserver*> observers;
 
+    /**
+     * @brief views into the parent exchange's flattened observer dispatch tables. Only used
+     * on step when observer_dispatch_valid is set, otherwise the observer map is walked.
+    */
+    std::span<DataFrameColObserver* const> col_observer_span;
+    std::span<AssetObserver* const> observer_span;
+    bool observer_dispatch_valid = false;
+
     std::optional<std::pair<long long, long long>> window = std::nullopt;
 
     ankerl::unordered_dense::map<std::string, size_t> headers;
 
+    /**
+     * @brief optional zone maps by column index, built once after load and read only afterwards
+    */
+    ankerl::unordered_dense::map<size_t, ZoneMap> zone_maps;
+
     [[nodiscard]] AgisResult<bool> load_headers();
     [[nodiscard]] AgisResult<bool> load_csv();
     const arrow::Status load_parquet();
+
+    /**
+     * @brief drop the precomputed columns of the observers after the data or warmup changed so
+     * they are rebuilt on the next reset
+    */
+    void invalidate_observers() noexcept;
 };
 
 struct MarketAsset
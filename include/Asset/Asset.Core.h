@@ -15,6 +15,25 @@ namespace Agis
 
 class Asset;
 
+//============================================================================
+/**
+ * @brief non-owning handle to an asset, its unique index and a raw pointer to it. Valid for
+ * the lifetime of a built Hydra instance, use AssetPtr only where ownership is needed.
+*/
+struct AssetHandle
+{
+	AssetHandle() = default;
+	AssetHandle(size_t index_, Asset* ptr_) : index(index_), ptr(ptr_) {}
+
+	size_t	index = 0;
+	Asset*	ptr = nullptr;
+
+	inline Asset* operator->() const noexcept { return this->ptr; }
+	inline Asset& operator*() const noexcept { return *this->ptr; }
+	explicit operator bool() const noexcept { return this->ptr != nullptr; }
+};
+
+
 //============================================================================
 struct TradeableAsset
 {
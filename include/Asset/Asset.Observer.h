@@ -11,18 +11,18 @@
 #include <optional>
 #include <unordered_map>
 #include <expected>
+#include <limits>
+#include <deque>
+#include <Eigen/Dense>
 #include "AgisPointers.h"
 #include "AgisException.h"
 
 
-struct AgisCovarianceMatrix;
-
 namespace Agis
 {
 
 class Asset;
 class AssetObserver;
-class IncrementalCovariance;
 
 using AssetObserverPtr = std::shared_ptr<AssetObserver>;
 
@@ -31,15 +31,99 @@ enum class AGIS_API AssetObserverType {
 	COL_ROL_MEAN,
 	COL_ROL_VAR,
 	COL_ROL_ZSCORE,
+	COL_ROL_COV,
+	COL_EWMA_MEAN,
+	COL_EWMA_VAR,
+	COL_ROL_MIN,
+	COL_ROL_MAX,
+	COL_ROL_ARGMIN,
+	COL_ROL_ARGMAX,
+	COL_ROL_RANK,
+	COL_ROL_MEDIAN,
+	COL_ROL_QUANTILE,
+	COL_ROL_OLS,
+};
+
+
+//============================================================================
+/**
+ * @brief which value of a shared rolling regression an OLS output observer returns from get_result
+*/
+enum class AGIS_API OLSOutput {
+	ALPHA,
+	BETA,
+	R2,
+	RESIDUAL,
+};
+
+
+//============================================================================
+/**
+ * @brief a regressor of a rolling OLS observer, column col of asset. If asset is null the
+ * observed asset's own column is used.
+*/
+struct OLSRegressor
+{
+	Asset* asset = nullptr;
+	std::string col;
+};
+
+
+//============================================================================
+/**
+ * @brief how rolling column observers are evaluated. PRECOMPUTE builds the full result column
+ * on reset and indexes into it, STREAMING keeps a ring buffer and running moments that are
+ * updated in O(1) on each step.
+*/
+enum class AGIS_API AssetObserverMode {
+	PRECOMPUTE,
+	STREAMING,
 };
 
 
 std::string AssetObserverTypeToString(AssetObserverType type);
 
 
+//============================================================================
+/**
+ * @brief canonical keys of the observers the matching create_* functions would build. Used to find
+ * an existing observer on the asset before constructing a new one, str_rep of every observer is
+ * built from these. The OLS keys take the observed asset to resolve regressors that default to it,
+ * roll_ols_observer_key is the shared regression and roll_ols_output_key one output of it.
+*/
+AGIS_API std::string roll_col_observer_key(
+	AssetObserverType type_,
+	std::string const& col_name_,
+	size_t r_count_
+);
+AGIS_API std::string roll_quantile_observer_key(
+	std::string const& col_name_,
+	size_t r_count_,
+	double quantile_
+);
+AGIS_API std::string roll_ols_observer_key(
+	Asset const* asset_,
+	std::string const& y_col_,
+	std::vector<OLSRegressor> const& regressors_,
+	size_t r_count_
+);
+AGIS_API std::string roll_ols_output_key(
+	Asset const* asset_,
+	std::string const& y_col_,
+	std::vector<OLSRegressor> const& regressors_,
+	size_t r_count_,
+	OLSOutput output_,
+	size_t beta_index_
+);
+AGIS_API std::string roll_cov_observer_key(
+	std::string const& col_a_,
+	std::string const& col_b_,
+	size_t r_count_
+);
+
+
 //============================================================================
 class AssetObserver {
-	friend struct AgisCovarianceMatrix;
 public:
 	virtual ~AssetObserver() {}
 	AssetObserver(NonNullRawPtr<Asset> asset_) : asset(asset_) {}
@@ -48,7 +132,6 @@ public:
 	virtual void on_step() = 0;
 	virtual void on_reset() = 0;
 	virtual inline double get_result() const noexcept = 0;
-	bool get_touch() const noexcept { return this->touch; }
 	size_t get_warmup() const noexcept { return this->warmup; }
 	NonNullRawPtr<Asset> get_asset_ptr() const noexcept { return this->asset; }
 
@@ -57,7 +140,15 @@ public:
 	}
 	virtual inline std::string str_rep() const noexcept = 0;
 
-	void set_touch(bool t) { this->touch = t; }
+	/**
+	 * @brief observers are shared between every strategy that requests the same str_rep on an
+	 * asset. Each request acquires a reference. Counts are cleared when the exchange is built and
+	 * re-acquired as the strategies build, so an observer left with no references, i.e. one only
+	 * a removed strategy used, is dropped by the exchange map's clean up.
+	*/
+	size_t get_ref_count() const noexcept { return this->ref_count; }
+	void __acquire() noexcept { this->ref_count++; }
+	void __clear_refs() noexcept { this->ref_count = 0; }
 
 protected:
 	void set_asset_ptr(Asset* asset_) { this->asset = asset_; }
@@ -69,11 +160,7 @@ protected:
 	size_t warmup = 0;
 
 private:
-	/**
-	 * @brief when an observer is created by a strategy it is added to the exchange. However
-	 * if no strategy attempts to create it when build method is called it will be removed
-	*/
-	bool touch = true;
+	size_t ref_count = 0;
 };
 
 
@@ -103,16 +190,38 @@ public:
 	 * @brief on asset rest move the index to start and build if needed
 	*/
 	void on_reset() override {
-		if (!this->is_built) {
-			this->build();
-		}
+		this->__ensure_built();
 		this->index = 0;
 	}
 
+	/**
+	 * @brief build the result column if it has not been built yet. Only touches this observer's
+	 * state so it can be called for many observers in parallel before the assets are reset.
+	*/
+	void __ensure_built() {
+		if (this->is_built) return;
+		this->build();
+		this->is_built = true;
+	}
+
+	/**
+	 * @brief mark the result column stale, called by the asset when its data or warmup changes
+	*/
+	void __invalidate() noexcept {
+		this->is_built = false;
+	}
+
 	/**
 	 * @brief on asset step increment the index
 	*/
-	void on_step() override {
+	void on_step() override final {
+		this->__advance();
+	}
+
+	/**
+	 * @brief non-virtual step used by the exchange's flattened observer dispatch
+	*/
+	inline void __advance() noexcept {
 		this->index++;
 	}
 
@@ -158,7 +267,7 @@ public:
 	void build() override;
 
 	std::string str_rep() const noexcept override {
-		return col_name + "_" + AssetObserverTypeToString(this->observer_type) + "_" + std::to_string(this->r_count);
+		return roll_col_observer_key(this->observer_type, this->col_name, this->r_count);
 	}
 
 private:
@@ -187,7 +296,7 @@ public:
 	void build() override;
 
 	std::string str_rep() const noexcept override {
-		return col_name + "_" + AssetObserverTypeToString(this->observer_type) + "_" + std::to_string(this->r_count);
+		return roll_col_observer_key(this->observer_type, this->col_name, this->r_count);
 	}
 
 private:
@@ -206,9 +315,7 @@ public:
 		size_t r_count_
 	) :
 		r_count(r_count_),
-		DataFrameColObserver(asset_, AssetObserverType::COL_ROL_ZSCORE),
-		mean_visitor(asset_, col_name_, r_count_),
-		var_visitor(asset_, col_name_, r_count_)
+		DataFrameColObserver(asset_, AssetObserverType::COL_ROL_ZSCORE)
 	{
 		this->col_name = col_name_;
 		this->set_warmup(r_count);
@@ -217,98 +324,488 @@ public:
 	void build() override;
 
 	std::string str_rep() const noexcept override {
-		return col_name + "_" + AssetObserverTypeToString(this->observer_type) + "_" + std::to_string(this->r_count) + "_ZScore";
+		return roll_col_observer_key(this->observer_type, this->col_name, this->r_count);
+	}
+
+private:
+	std::string col_name;
+	size_t r_count;
+};
+
+
+//============================================================================
+/**
+ * @brief running co-moment of two series that supports adding and removing observations.
+ * Var is the special case x == y.
+*/
+struct SlidingCoMoment
+{
+	size_t n = 0;
+	double mean_x = 0;
+	double mean_y = 0;
+	double c = 0;
+
+	inline void add(double x, double y) noexcept {
+		n++;
+		double dx = x - mean_x;
+		mean_x += dx / n;
+		mean_y += (y - mean_y) / n;
+		c += dx * (y - mean_y);
+	}
+
+	inline void remove(double x, double y) noexcept {
+		if (n <= 1) {
+			this->clear();
+			return;
+		}
+		double mean_x_prev = mean_x - (x - mean_x) / (n - 1);
+		c -= (x - mean_x_prev) * (y - mean_y);
+		mean_y -= (y - mean_y) / (n - 1);
+		mean_x = mean_x_prev;
+		n--;
+	}
+
+	inline double sample_covariance() const noexcept {
+		if (n < 2) return std::numeric_limits<double>::quiet_NaN();
+		return c > 0.0 || c < 0.0 ? c / (n - 1) : 0.0;
 	}
 
+	inline void clear() noexcept {
+		n = 0;
+		mean_x = 0;
+		mean_y = 0;
+		c = 0;
+	}
+};
+
+
+//============================================================================
+/**
+ * @brief streaming rolling mean, variance or z-score of a column. Keeps a ring buffer of the 
+ * last r_count values and running moments updated in O(1) on each step. Missing values are
+ * skipped. Has the same string representation and get_result contract as the precomputed
+ * visitors, debug builds check the two agree on every reset.
+*/
+class StreamingColObserver : public AssetObserver
+{
+public:
+	StreamingColObserver(
+		Asset* asset_,
+		AssetObserverType type_,
+		std::string col_name_,
+		size_t r_count_
+	);
+
+	void on_step() override;
+	void on_reset() override;
+	double get_result() const noexcept override;
+	std::string str_rep() const noexcept override;
+
 private:
+	void push(double x) noexcept;
+#ifdef _DEBUG
+	void verify_precompute() const;
+#endif
+
+	AssetObserverType observer_type;
 	std::string col_name;
+	size_t col_index = 0;
+	size_t r_count;
+
+	std::vector<double> buffer;
+	size_t head = 0;
+	double last = 0;
+	SlidingCoMoment moments;
+};
+
+
+//============================================================================
+/**
+ * @brief streaming rolling sample covariance between two columns of the same asset, pairs with
+ * a missing value are skipped
+*/
+class StreamingCovObserver : public AssetObserver
+{
+public:
+	StreamingCovObserver(
+		Asset* asset_,
+		std::string col_a_,
+		std::string col_b_,
+		size_t r_count_
+	);
+
+	void on_step() override;
+	void on_reset() override;
+	double get_result() const noexcept override { return this->moments.n < this->r_count ? std::numeric_limits<double>::quiet_NaN() : this->moments.sample_covariance(); }
+	std::string str_rep() const noexcept override;
+
+private:
+	std::string col_a;
+	std::string col_b;
+	size_t col_a_index = 0;
+	size_t col_b_index = 0;
 	size_t r_count;
-	MeanVisitor mean_visitor;
-	VarVisitor var_visitor;
+
+	std::vector<std::pair<double, double>> buffer;
+	size_t head = 0;
+	SlidingCoMoment moments;
+};
+
+
+//============================================================================
+/**
+ * @brief exponentially weighted mean or variance of a column with a configurable half-life.
+ * State is O(1) per asset with no window buffer. Decay is alpha = 1 - 0.5^(1 / half_life),
+ * NaN values are skipped and the result is NaN until half_life observations have been seen.
+*/
+class EWMAObserver : public AssetObserver
+{
+public:
+	EWMAObserver(
+		Asset* asset_,
+		AssetObserverType type_,
+		std::string col_name_,
+		size_t half_life_
+	);
+
+	void on_step() override;
+	void on_reset() override;
+	double get_result() const noexcept override;
+	std::string str_rep() const noexcept override;
+
+private:
+	AssetObserverType observer_type;
+	std::string col_name;
+	size_t col_index = 0;
+	size_t half_life;
+	double alpha;
+
+	size_t count = 0;
+	double mean = 0;
+	double var = 0;
 };
 
 
 //============================================================================
-class IncrementalCovariance : public AssetObserver
+/**
+ * @brief rolling min, max, argmin or argmax of a column. Candidates are kept in a monotonic deque
+ * so each step is amortised O(1). The arg variants return the number of bars since the extreme
+ * (0 = current bar). NaN values are skipped, the result is NaN until the window is full.
+*/
+class RollingExtremaObserver : public AssetObserver
 {
-	friend struct AgisCovarianceMatrix;
 public:
-	IncrementalCovariance(
-		std::shared_ptr<Asset> a1,
-		std::shared_ptr<Asset> a2
+	RollingExtremaObserver(
+		Asset* asset_,
+		AssetObserverType type_,
+		std::string col_name_,
+		size_t r_count_
 	);
 
-	size_t step_size = 1;
-	size_t period = 252;
+	void on_step() override;
+	void on_reset() override;
+	double get_result() const noexcept override;
+	std::string str_rep() const noexcept override;
+
+private:
+	AssetObserverType observer_type;
+	std::string col_name;
+	size_t col_index = 0;
+	size_t r_count;
+	bool is_max;
+
+	size_t step_count = 0;
+	std::deque<std::pair<size_t, double>> candidates;
+};
+
+
+//============================================================================
+/**
+ * @brief multiset of doubles with expected O(log n) insert, erase, rank and order statistic
+ * queries. A treap over a node pool sized on construction, so memory is bounded by the number
+ * of values held at once rather than by the distinct values ever seen.
+*/
+class OrderStatisticTree
+{
+public:
+	explicit OrderStatisticTree(size_t capacity = 0);
 
 	/**
-	 * @brief set the pointers into the covariance matrix that this incremental covariance struct will update
-	 * @param upper_triangular_ pointer to the upper triangular portion of the covariance matrix
-	 * @param lower_triangular_ pointer to the lower triangular portion of the covariance matrix
+	 * @brief insert a value, the tree must hold fewer than capacity values
 	*/
-	void set_pointers(double* upper_triangular_, double* lower_triangular_);
+	void insert(double value) noexcept;
 
-	void set_step_size(size_t step_size_) { this->step_size = step_size_; }
-	void set_period(size_t period_) { this->period = period_; }
+	/**
+	 * @brief erase one copy of a value, does nothing if the value is not held
+	*/
+	void erase(double value) noexcept;
 
 	/**
-	 * @brief function called on step of exchange to update this incremental covariance struct
+	 * @brief number of values <= value
 	*/
-	void on_step() override;
+	size_t count_less_equal(double value) const noexcept;
 
 	/**
-	 * @brief function called on reset of exchange to reset this incremental covariance struct
+	 * @brief k-th smallest value (0 based), k must be less than size
 	*/
+	double select(size_t k) const noexcept;
+
+	size_t size() const noexcept { return this->node_size(this->root); }
+	void clear() noexcept;
+
+private:
+	static constexpr size_t null_node = std::numeric_limits<size_t>::max();
+
+	struct Node {
+		double value = 0;
+		uint32_t priority = 0;
+		size_t left = null_node;
+		size_t right = null_node;
+		size_t size = 0;
+	};
+
+	size_t node_size(size_t n) const noexcept { return n == null_node ? 0 : this->nodes[n].size; }
+	void update(size_t n) noexcept;
+	void split(size_t n, double value, size_t& lo, size_t& hi) noexcept;
+	void split_first(size_t n, size_t& first, size_t& rest) noexcept;
+	size_t merge(size_t a, size_t b) noexcept;
+
+	std::vector<Node> nodes;
+	std::vector<size_t> free_nodes;
+	size_t root = null_node;
+	uint32_t seed = 2463534242u;
+};
+
+
+//============================================================================
+/**
+ * @brief rolling percentile rank, median or quantile of a column. The window is kept in an
+ * order statistic tree of at most r_count values, so inserts, removals, rank and order statistic
+ * queries are O(log r_count) and values never seen before are handled as they arrive.
+ * Rank is the fraction of the window <= the current value, quantiles interpolate linearly
+ * between order statistics. NaN values are skipped.
+*/
+class RollingRankObserver : public AssetObserver
+{
+public:
+	RollingRankObserver(
+		Asset* asset_,
+		AssetObserverType type_,
+		std::string col_name_,
+		size_t r_count_,
+		double quantile_ = 0.5
+	);
+
+	void on_step() override;
 	void on_reset() override;
+	double get_result() const noexcept override;
+	std::string str_rep() const noexcept override;
+
+private:
+	AssetObserverType observer_type;
+	std::string col_name;
+	size_t col_index = 0;
+	size_t r_count;
+	double quantile;
+
+	OrderStatisticTree tree;
 
 	/**
-	 * @brief get the string representation of this incremental covariance struct
-	 * @return the string representation of this incremental covariance struct
+	 * @brief ring buffer of the values in the window, NaN for skipped rows
 	*/
+	std::vector<double> buffer;
+	size_t head = 0;
+	size_t step_count = 0;
+	double current = std::numeric_limits<double>::quiet_NaN();
+};
+
+
+//============================================================================
+/**
+ * @brief rolling OLS regression of a column of the observed asset on k regressors with an
+ * intercept. Keeps the sums X'X, X'y and y'y of the window and updates them in O(k^2) on each
+ * step, the normal equations are then solved for the (k+1) coefficients. Rows where any value
+ * is NaN are skipped. Inputs are shifted by their first observed values to keep the sums small.
+ * One regression is kept per (y, regressors, window), its outputs are read through
+ * RollingOLSOutputObserver views. get_result is the slope on the first regressor.
+*/
+class RollingOLSObserver : public AssetObserver
+{
+public:
+	RollingOLSObserver(
+		Asset* asset_,
+		std::string y_col_,
+		std::vector<OLSRegressor> regressors_,
+		size_t r_count_
+	);
+
+	void on_step() override;
+	void on_reset() override;
+	double get_result() const noexcept override;
 	std::string str_rep() const noexcept override;
 
+	double get_alpha() const noexcept;
+	double get_beta(size_t i) const noexcept;
+	double get_r2() const noexcept { return this->r2; }
+	double get_residual() const noexcept { return this->residual; }
+	size_t get_regressor_count() const noexcept { return this->k; }
+
+private:
+	void update_row(double const* row, double sign) noexcept;
+	void solve() noexcept;
+
 	/**
-	 * @brief get the current covariance value
-	 * @return the current covariance value
+	 * @brief cache the regressor columns and datetime indexes and rewind the cursors
 	*/
-	inline double get_result() const noexcept override
-	{
-		return covariance;
-	}
+	void bind_regressors() noexcept;
 
-private:
-	std::shared_ptr<Asset> enclosing_asset = nullptr;
-	std::shared_ptr<Asset> child_asset = nullptr;
-	std::span<double const> enclosing_span;
-	std::span<double const> child_span;
-	size_t enclosing_span_start_index;
-	size_t index = 0;
-	double sum1 = 0;
-	double sum2 = 0;
-	double sum_product = 0;
-	double sum1_squared = 0;
-	double sum2_squared = 0;
-	double covariance = 0;
-
-	double* upper_triangular = nullptr;
-	double* lower_triangular = nullptr;
-};
+	/**
+	 * @brief value of regressor i at datetime t, NaN if its asset has no bar at t
+	*/
+	double read_regressor(size_t i, long long t) noexcept;
+
+	std::string y_col;
+	size_t y_index = 0;
+	std::vector<OLSRegressor> regressors;
+	std::vector<size_t> regressor_index;
+	size_t r_count;
+	size_t k;
+
+	std::vector<double> shift;
+	bool shift_set = false;
+
+	/**
+	 * @brief ring buffer of shifted rows [1, x_1 .. x_k, y], row_valid is false for skipped rows
+	*/
+	std::vector<double> buffer;
+	std::vector<char> row_valid;
+	size_t head = 0;
+	size_t step_count = 0;
+	size_t n = 0;
+
+	std::vector<double> xtx;
+	std::vector<double> xty;
+	double yty = 0;
+	double y_sum = 0;
 
+	std::vector<double> coef;
+	double r2 = std::numeric_limits<double>::quiet_NaN();
+	double residual = std::numeric_limits<double>::quiet_NaN();
 
+	/**
+	 * @brief regressors are read at the observed asset's current datetime rather than at the
+	 * reference asset's current row, so the fit does not depend on the order assets and exchanges
+	 * step in. The cursors only move forward between resets.
+	*/
+	std::vector<std::span<double const>> regressor_columns;
+	std::vector<std::span<long long const>> regressor_dt_index;
+	std::vector<size_t> regressor_cursor;
+
+	/**
+	 * @brief normal equations and their factorisation, sized once so solve does not allocate
+	*/
+	Eigen::MatrixXd normal_matrix;
+	Eigen::VectorXd normal_rhs;
+	Eigen::VectorXd solution;
+	Eigen::LDLT<Eigen::MatrixXd> ldlt;
+};
 
 
 //============================================================================
-AGIS_API std::expected<AssetObserverPtr, AgisException> create_inc_cov_observer(
-	std::shared_ptr<Asset> a1,
-	std::shared_ptr<Asset> a2
-);
+/**
+ * @brief one output of a shared rolling regression. Does no work on step, get_result reads the
+ * regression's current fit, so any number of outputs cost a single regression update per bar.
+*/
+class RollingOLSOutputObserver : public AssetObserver
+{
+public:
+	RollingOLSOutputObserver(
+		Asset* asset_,
+		RollingOLSObserver const* regression_,
+		OLSOutput output_,
+		size_t beta_index_ = 0
+	);
+
+	void on_step() override {}
+	void on_reset() override {}
+	double get_result() const noexcept override;
+	std::string str_rep() const noexcept override;
+
+private:
+	RollingOLSObserver const* regression;
+	OLSOutput output;
+	size_t beta_index;
+};
 
 
 //============================================================================
+/**
+ * @brief create a rolling column observer
+ * @param asset_ asset to observe
+ * @param type_ type of observer to create
+ * @param col_name_ name of the column to observe
+ * @param r_count_ window size, or the half-life for the exponentially weighted types
+ * @param mode_ precompute the full column or stream the result on each step
+*/
 AGIS_API std::expected<AssetObserverPtr, AgisException> create_roll_col_observer(
 	Asset* asset_,
 	AssetObserverType type_,
 	std::string col_name_,
+	size_t r_count_,
+	AssetObserverMode mode_ = AssetObserverMode::PRECOMPUTE
+);
+
+
+//============================================================================
+/**
+ * @brief create a rolling quantile observer
+ * @param quantile_ quantile to track, in [0, 1]
+*/
+AGIS_API std::expected<AssetObserverPtr, AgisException> create_roll_quantile_observer(
+	Asset* asset_,
+	std::string col_name_,
+	size_t r_count_,
+	double quantile_
+);
+
+
+//============================================================================
+/**
+ * @brief create a rolling OLS regression observer
+ * @param y_col_ column of the observed asset used as the dependent variable
+ * @param regressors_ columns of reference assets used as the independent variables
+ * @param r_count_ window size
+*/
+AGIS_API std::expected<AssetObserverPtr, AgisException> create_roll_ols_observer(
+	Asset* asset_,
+	std::string y_col_,
+	std::vector<OLSRegressor> regressors_,
+	size_t r_count_
+);
+
+
+//============================================================================
+/**
+ * @brief create a view over one output of a rolling regression, the regression built by
+ * create_roll_ols_observer with the same arguments must already be on the asset
+ * @param output_ value returned by get_result
+ * @param beta_index_ which coefficient to return when output_ is BETA
+*/
+AGIS_API std::expected<AssetObserverPtr, AgisException> create_roll_ols_output_observer(
+	Asset* asset_,
+	std::string y_col_,
+	std::vector<OLSRegressor> regressors_,
+	size_t r_count_,
+	OLSOutput output_,
+	size_t beta_index_
+);
+
+
+//============================================================================
+AGIS_API std::expected<AssetObserverPtr, AgisException> create_roll_cov_observer(
+	Asset* asset_,
+	std::string col_a_,
+	std::string col_b_,
 	size_t r_count_
 );
 
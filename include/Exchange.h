@@ -12,12 +12,14 @@
 #include "AgisRisk.h"
 #include "AgisEnums.h"
 #include "ExchangeView.h"
+#include "Asset/Asset.Observer.h"
 
 namespace Agis {
 	class Asset;
 	class AssetTable;
 	struct MarketAsset;
 	class AssetObserver;
+	class DataFrameColObserver;
 	class TradingCalendar;
 }
 
@@ -118,6 +120,113 @@ public:
 		size_t warmup = 0
 	);
 
+	/**
+	 * @brief get a view into the exchange by applying a callable to each visible asset. Unlike the
+	 * std::function overload the callable is inlined into the gather loop and returns a plain double,
+	 * NaN excludes the asset.
+	 * @param func callable taking the asset by const reference and returning a double
+	 * @param query_type type of sorting to do
+	 * @param N number of assets to return, defaults -1 means all
+	*/
+	template <typename Func>
+		requires std::is_invocable_r_v<double, Func const&, Asset const&>
+	ExchangeView get_exchange_view(
+		Func const& func,
+		ExchangeQueryType query_type = ExchangeQueryType::Default,
+		int N = -1) const
+	{
+		auto number_assets = (N == -1) ? this->assets.size() : static_cast<size_t>(N);
+		ExchangeView exchange_view(this, number_assets);
+		auto& view = exchange_view.view;
+		this->__get_live_assets().for_each_set(
+			this->exchange_offset,
+			this->exchange_offset + this->assets.size(),
+			[&](size_t asset_index) {
+				auto position = asset_index - this->exchange_offset;
+				if (!this->__is_visible(position)) return;
+				double x = func(*this->assets[position]);
+				if (std::isnan(x)) return;
+				view.emplace_back(asset_index, x, true);
+			}
+		);
+		exchange_view.sort(number_assets, query_type);
+		return exchange_view;
+	}
+
+	/**
+	 * @brief is the asset at this position in the asset vector visible to exchange views this step.
+	 * Exported as the templated get_exchange_view is instantiated in the caller's module.
+	*/
+	AGIS_API bool __is_visible(size_t position) const noexcept;
+
+	/**
+	 * @brief live asset bitmap of the parent exchange map. Defined out of line and exported as
+	 * ExchangeMap is incomplete here, the templated get_exchange_view reaches it through this.
+	*/
+	AGIS_API AtomicBitmap const& __get_live_assets() const noexcept;
+
+	/**
+	 * @brief store a column as a time by asset panel aligned to the exchange's datetime index,
+	 * missing bars are NaN. Panels are built by build, afterwards cross-sectional reads of the
+	 * current row (get_exchange_view, gather_column, get_cross_section) read one contiguous row
+	 * instead of every asset's data.
+	 * @param col name of the column
+	*/
+	AGIS_API AgisResult<bool> add_panel_column(std::string const& col);
+
+	/**
+	 * @brief row of a panel column at the current exchange time offset by row. Asset order matches
+	 * the exchange's asset vector. A negative row is the previous exchange time, which is not the
+	 * previous bar of an asset missing bars.
+	 * @return the row if the column has a panel
+	*/
+	std::optional<std::span<double const>> __get_panel_row(size_t col_index, int row = 0) const noexcept;
+
+	/**
+	 * @brief gather the value of a column for every visible asset into a caller owned buffer.
+	 * Reads the asset's column major data directly, NaN values are skipped.
+	 * @param col_index column index resolved once with get_column_index
+	 * @param row row index to query (0, current) (-1, previous)
+	 * @param buffer buffer to fill, cleared first
+	*/
+	AGIS_API void gather_column(size_t col_index, int row, ExchangeColumnBuffer& buffer) const noexcept;
+
+	/**
+	 * @brief get a view into the exchange using a pre-resolved column index. Values are gathered into
+	 * the caller's buffer and the top/bottom N are selected on an index permutation, only the
+	 * selected assets are copied into the returned view.
+	 * @param col_index column index resolved once with get_column_index
+	 * @param buffer reusable gather buffer owned by the caller
+	 * @param row row index to query (0, current) (-1, previous)
+	 * @param query_type type of sorting to do
+	 * @param N number of assets to return, defaults -1 means all
+	*/
+	AGIS_API ExchangeView get_exchange_view(
+		size_t col_index,
+		ExchangeColumnBuffer& buffer,
+		int row = 0,
+		ExchangeQueryType query_type = ExchangeQueryType::Default,
+		int N = -1
+	) const;
+
+	/**
+	 * @brief cross-sectional transform of a column across the visible assets at the current step.
+	 * Memoised by (column, row, transform, param), the first caller each step computes it and every
+	 * later caller shares the result until the exchange steps again. Callers of different keys
+	 * compute concurrently, callers of a key being computed wait for it.
+	 * @param col name of the column to transform
+	 * @param transform rank, demean, z-score or winsorise
+	 * @param param tail quantile clipped by winsorise, must be in [0, 0.5). Ignored otherwise
+	 * @param row row index to query (0, current) (-1, previous)
+	 * @return shared view of the transformed values in asset index order
+	*/
+	AGIS_API std::expected<std::shared_ptr<ExchangeView const>, AgisException> get_cross_section(
+		std::string const& col,
+		CrossSectionTransform transform,
+		double param = 0.0,
+		int row = 0
+	) const;
+
 	/// <summary>
 	/// Remove an asset from an exchange, do not call directly, got through exchange map
 	/// </summary>
@@ -153,6 +262,14 @@ public:
 
 	AGIS_API AgisResult<size_t> get_column_index(std::string const& col) const;
 
+	/**
+	 * @brief build the per block min/max zone map of a column on every asset listed on the exchange.
+	 * Exchange view nodes with a zone filter on that column can then skip assets without reading them.
+	 * @param col name of the column
+	 * @param block_size number of rows summarised by each zone
+	*/
+	AGIS_API AgisResult<bool> build_zone_maps(std::string const& col, size_t block_size = 256);
+
 	AGIS_API [[nodiscard]] AssetType get_asset_type() const noexcept { return this->asset_type; }
 	AGIS_API size_t get_candle_count() const noexcept { return this->candles; };
 	AGIS_API size_t get_asset_count() const noexcept { return this->assets.size(); }
@@ -173,6 +290,14 @@ public:
 	AGIS_API [[nodiscard]] size_t __get_exchange_offset() const { return this->exchange_offset; };
 	AGIS_API [[nodiscard]] auto& __get_asset_observers() { return this->asset_observers; };
 
+	/**
+	 * @brief set how rolling column observers created on this exchange are evaluated. Streaming
+	 * observers update running moments in O(1) per step instead of precomputing the full column.
+	 * @param mode observer mode used by observers created after the call
+	*/
+	AGIS_API void set_observer_mode(AssetObserverMode mode) noexcept { this->observer_mode = mode; }
+	AGIS_API [[nodiscard]] AssetObserverMode get_observer_mode() const noexcept { return this->observer_mode; }
+
 	void __goto(long long datetime);
 	bool __is_valid_order(std::unique_ptr<Order>& order) const;
 	void __place_order(std::unique_ptr<Order> order) noexcept;
@@ -186,6 +311,31 @@ public:
 	void __add_asset_table(AssetTablePtr&& table) noexcept;
 	std::lock_guard<std::mutex> __write_lock() { return std::lock_guard<std::mutex>(this->_mutex); }
 
+	/**
+	 * @brief flatten the observers registered on each asset into contiguous per type tables owned
+	 * by the exchange. The asset's observer map is still used for name lookups.
+	*/
+	void __build_observer_dispatch();
+
+	/**
+	 * @brief rebuild the observer dispatch tables then build the result column of every column
+	 * observer in parallel. Asset resets after this only need to rewind the observers.
+	*/
+	void __build_observers();
+
+	/**
+	 * @brief compute the rolling beta of every asset against the market asset. The market index and
+	 * close column are fetched once and shared by all assets, each asset is aligned to the market
+	 * with a single forward merge of the two sorted datetime indexes. Fails listing every asset
+	 * whose beta could not be set.
+	*/
+	[[nodiscard]] AgisResult<bool> __set_beta_vectors(AssetPtr const& market_asset, size_t beta_lookback);
+
+	/**
+	 * @brief allocate and fill every registered panel column from the assets' data
+	*/
+	void __build_panels();
+
 	AGIS_API std::expected<bool, AgisException> load_trading_calendar(std::string const& path);
 	std::shared_ptr<TradingCalendar> get_trading_calendar() const noexcept {return this->_calendar; }
 
@@ -226,6 +376,35 @@ private:
 	ankerl::unordered_dense::map<std::string, std::shared_ptr<Agis::AssetTable>> asset_tables;
 	std::vector<std::shared_ptr<AssetObserver>> asset_observers;
 
+	/**
+	 * @brief flattened observer dispatch tables, grouped by asset. Column observers are stepped
+	 * with a non-virtual index increment, all other observer types use the virtual on_step.
+	*/
+	std::vector<DataFrameColObserver*> col_observer_dispatch;
+	std::vector<AssetObserver*> observer_dispatch;
+
+	/**
+	 * @brief a cross-sectional transform computed at most once per step by whichever caller
+	 * gets to it first
+	*/
+	struct CrossSectionEntry {
+		std::once_flag once;
+		std::shared_ptr<ExchangeView const> view;
+	};
+
+	/**
+	 * @brief cross-sectional transforms requested this step, cleared on step and reset. The mutex
+	 * only guards the lookup, entries are computed outside of it.
+	*/
+	mutable ankerl::unordered_dense::map<std::string, std::shared_ptr<CrossSectionEntry>> cross_section_cache;
+	mutable std::mutex cross_section_mutex;
+
+	/**
+	 * @brief time by asset panels of selected columns keyed by column index, row t holds every
+	 * asset's value at dt_index[t]
+	*/
+	ankerl::unordered_dense::map<size_t, std::vector<double>> panels;
+
 	ankerl::unordered_dense::map<std::string, size_t> headers;
 	ExchangeMap* exchanges;
 
@@ -240,23 +419,38 @@ private:
 	size_t warmup = 0;
 	size_t volatility_lookback = 0;
 	size_t candles = 0;
+	AssetObserverMode observer_mode = AssetObserverMode::PRECOMPUTE;
 	bool is_built = false;
 };
 
 
 //============================================================================
-template <typename Func, typename... Args>
+/**
+ * @brief add an observer to every asset on the exchange
+ * @param key_func takes the asset and returns the canonical key of the observer func would build for it
+ * @param func creates the observer for an asset
+*/
+template <typename KeyFunc, typename Func, typename... Args>
 AgisResult<bool> exchange_add_observer(
 	ExchangePtr exchange,
+	KeyFunc key_func,
 	Func func, 
-	Args&&... args
+	Args const&... args
 ) {
 	auto& observers = exchange->__get_asset_observers();
 	for (auto& asset : exchange->get_assets()) {
-		std::expected<AssetObserverPtr, AgisException> observer = func(asset.get(), std::forward<Args>(args)...);
+		// share an existing observer with the same canonical key, only construct on a miss as
+		// building an observer can touch the whole column
+		auto existing = asset->get_observer(key_func(asset.get()));
+		if (!existing.is_exception()) {
+			existing.unwrap()->__acquire();
+			continue;
+		}
+		std::expected<AssetObserverPtr, AgisException> observer = func(asset.get(), args...);
 		if (!observer.has_value()) return AgisResult<bool>(observer.error());
 		exchange->__add_asset_observer(observer.value());
 		auto asset_obv_raw = observers.back().get();
+		asset_obv_raw->__acquire();
 		asset->add_observer(asset_obv_raw);
 	}
 	return AgisResult<bool>(true);
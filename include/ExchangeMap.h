@@ -7,6 +7,7 @@
 #include "pch.h" 
 #include "AgisEnums.h"
 #include "AgisRisk.h"
+#include "Asset/Asset.Core.h"
 
 
 namespace Agis {
@@ -86,6 +87,13 @@ public:
 	AGIS_API AgisResult<AssetPtr> get_asset(std::string const& asset_id) const;
 	AGIS_API AgisResult<AssetPtr> get_asset(size_t index) const;
 
+	/**
+	 * @brief get a non-owning handle to an asset by its index, avoids the shared_ptr copy of get_asset
+	 * @param index unique index of the asset
+	 * @return handle to the asset if the index is valid and the map is built
+	*/
+	AGIS_API std::expected<AssetHandle, AgisStatusCode> get_asset_handle(size_t index) const noexcept;
+
 	/// <summary>
 	/// Remove an asset from the exchange map by asset id
 	/// </summary>
@@ -112,6 +120,20 @@ public:
 	std::vector<ExchangePtr> get_exchanges() const;
 
 	AGIS_API auto const& get_assets() const noexcept { return this->assets; }
+
+	/**
+	 * @brief get a raw pointer to an asset by its index. Uses the routing table built in __build,
+	 * pointer is valid for the lifetime of the built exchange map. No bounds checking.
+	 * @param index unique index of the asset
+	*/
+	inline Asset* __get_asset_ptr(size_t index) const noexcept { return this->asset_routes[index]; }
+
+	/**
+	 * @brief get a raw pointer to the exchange an asset is listed on by the asset's index.
+	 * Uses the routing table built in __build. No bounds checking.
+	 * @param index unique index of the asset
+	*/
+	inline Exchange* __get_asset_exchange(size_t index) const noexcept { return this->exchange_routes[index]; }
 	AGIS_API bool asset_exists(std::string const& asset_id) const;
 
 	/// <summary>
@@ -136,12 +158,20 @@ public:
 	AGIS_API AgisResult<bool> init_covariance_matrix(size_t lookback, size_t step_size);
 
 	/**
-	 * @brief disable or enable covariance matrix tracking by either adding or removing asset observers
+	 * @brief disable or enable covariance matrix tracking on exchange map step
 	 * @param enabled
 	 * @return
 	*/
 	AGIS_API AgisResult<bool> set_covariance_matrix_state(bool enabled);
 
+	/**
+	 * @brief set the estimator used by the covariance matrix
+	 * @param estimator sample, Ledoit-Wolf shrinkage or k-factor model
+	 * @param factor_count number of principal components used by the factor model
+	 * @return result of the attempted change
+	*/
+	AGIS_API AgisResult<bool> set_covariance_estimator(CovarianceEstimator estimator, size_t factor_count = 0);
+
 	/**
 	 * @brief get a const pointer to the agis covariance matrix
 	 * @return
@@ -239,13 +269,6 @@ public:
 	TimePoint epoch_to_tp(long long epoch);
 	TimePoint const& get_tp() const { return this->time_point; }
 
-	/**
-	 * @brief place an asset in the the assets vector
-	 * @param asset_index unique index of the asset
-	 * @param asset asset to place in the vector
-	*/
-	void __set_asset(size_t asset_index, std::shared_ptr<Asset> asset);
-
 	/**
 	 * @brief set the volatility lookback period of all exchanges registered
 	 * @param window_size lookback period to set
@@ -277,6 +300,13 @@ public:
 
 	ThreadSafeVector<size_t> const& __get_expired_index_list() const { return this->expired_asset_index; }
 
+	/**
+	 * @brief bitmap of live assets by asset index. Expired assets are cleared once per step,
+	 * the assets themselves stay addressable by index.
+	*/
+	AtomicBitmap const& __get_live_assets() const noexcept { return this->live_assets; }
+	inline bool __is_live(size_t asset_index) const noexcept { return this->live_assets.test(asset_index); }
+
 private:
 	std::mutex _mutex;
 	ankerl::unordered_dense::map<std::string, ExchangePtr> exchanges;
@@ -284,7 +314,13 @@ private:
 	ankerl::unordered_dense::map<Frequency, AssetPtr> market_assets;
 
 	std::vector<std::shared_ptr<Asset>> assets;
-	std::vector<std::shared_ptr<Asset>> assets_expired;
+	AtomicBitmap live_assets;
+
+	/**
+	 * @brief dense asset index routing tables materialised in __build
+	*/
+	std::vector<Asset*> asset_routes;
+	std::vector<Exchange*> exchange_routes;
 
 	ThreadSafeVector<size_t> expired_asset_index;
 	std::shared_ptr<AgisCovarianceMatrix> covariance_matrix = nullptr;
@@ -42,6 +42,18 @@ enum ExchangeQueryType
 };
 
 
+/**
+ * @brief cross-sectional transform applied to a column across all visible assets of an exchange
+*/
+enum class CrossSectionTransform
+{
+	RANK,		/// rank from 1 to N, tied values share their average rank
+	DEMEAN,		/// value minus the cross-sectional mean
+	ZSCORE,		/// demeaned value divided by the cross-sectional sample std
+	WINSORISE	/// value clipped to the [q, 1 - q] cross-sectional quantiles
+};
+
+
 enum class ExchangeViewOpp
 {
 	UNIFORM,			/// applies 1/N weight to each pair
@@ -98,6 +110,25 @@ struct ExchangeViewAllocation {
 	bool live = false;
 };
 
+/**
+ * @brief struct of arrays gather buffer for one column across an exchange. Owned by the caller and
+ * reused every step, so once it has grown to the asset count a gather does not allocate.
+*/
+struct ExchangeColumnBuffer
+{
+	std::vector<size_t> asset_index;
+	std::vector<double> values;
+
+	/**
+	 * @brief scratch permutation used to select the top/bottom N without moving the values
+	*/
+	std::vector<size_t> order;
+
+	void clear() noexcept { asset_index.clear(); values.clear(); }
+	size_t size() const noexcept { return values.size(); }
+};
+
+
 struct ExchangeView
 {
 private:
@@ -159,6 +190,12 @@ public:
 	*/
 	AGIS_API AgisResult<bool> vol_target(double target);
 
+	/**
+	 * @brief vol target using the caller's covariance block, reused while the allocated assets
+	 * and the covariance window are unchanged
+	*/
+	AGIS_API AgisResult<bool> vol_target(double target, AgisCovarianceBlock& cache);
+
 
 	/// <summary>
 	/// Generate a beta hedge for the portfolio and adjust allocation weights to match 
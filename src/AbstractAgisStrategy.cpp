@@ -207,7 +207,7 @@ public:
 private:
 	ExchangeViewOpp ev_opp_type = ExchangeViewOpp::{EV_OPP_TYPE};
 	ExchangePtr exchange = nullptr;
-	size_t warmup = {WARMUP};
+	size_t warmup = {WARMUP};{COLUMN_MEMBERS}
 };
 )";
 
@@ -232,6 +232,20 @@ private:
 		strategy_header.replace(pos, 16, "std::nullopt");
 	}
 
+	// a chain that only reads one column gathers it by a column index resolved in build into a
+	// buffer reused every step, instead of calling the lambda chain on every asset
+	std::optional<AssetOpperationStruct> column_read = std::nullopt;
+	if (ev_lambda_ref.asset_lambda.size() == 1) {
+		auto& pair = ev_lambda_ref.asset_lambda[0];
+		if (pair.is_operation() && OppToString(pair.get_agis_operation()) == "agis_init") {
+			column_read = pair.get_asset_operation_struct();
+		}
+	}
+	pos = strategy_header.find("{COLUMN_MEMBERS}");
+	strategy_header.replace(pos, 16, column_read ? R"(
+	size_t col_index = 0;
+	ExchangeColumnBuffer column_buffer;)" : "");
+
 	// Replace strategy class name
 	std::string place_holder = "{STRATEGY_ID}";
 	std::string strategy_id = this->get_strategy_id();
@@ -246,6 +260,11 @@ private:
 		R"(this->exchange_subscribe("{EXCHANGE_ID}");
 	this->exchange = this->get_exchange();)";
 	str_replace_all(build_method, "{EXCHANGE_ID}", this->get_exchange()->get_exchange_id());
+	if (column_read) {
+		build_method += R"(
+	this->col_index = this->exchange->get_column_index("{COL}").unwrap();)";
+		str_replace_all(build_method, "{COL}", column_read->column);
+	}
 
 	// build the vector of asset lambdas to be used when calling next
 	std::string asset_lambda = R"(std::vector<AssetLambdaScruct> operations = { )";
@@ -281,7 +300,9 @@ private:
 		i++;
 	}
 	// agis strategy next method
-	std::string next_method = R"(auto next_lambda = [&operationsRef](const AssetPtr& asset) -> AgisResult<double> {			
+	std::string next_method = R"(auto& operationsRef = operations; // Create a reference to operations
+
+	auto next_lambda = [&operationsRef](const AssetPtr& asset) -> AgisResult<double> {			
 		return asset_feature_lambda_chain(
 			asset, 
 			operationsRef
@@ -306,6 +327,30 @@ private:
 
 	)";
 
+	if (column_read) {
+		asset_lambda = "";
+		next_method = R"(auto ev = this->exchange->get_exchange_view(
+		this->col_index,
+		this->column_buffer,
+		{INDEX},
+		ExchangeQueryType::{EXCHANGE_QUERY_TYPE},
+		{N}
+	);
+
+	{EV_TRANSFORM}
+
+	this->strategy_allocate(
+		ev,
+		{EPSILON},
+		{CLEAR},
+		std::nullopt,
+		AllocType::{ALLOC_TYPE}
+	);
+
+	)";
+		str_replace_all(next_method, "{INDEX}", std::to_string(column_read->row));
+	}
+
 	// Replace the exchange query type
 	pos = next_method.find("{EXCHANGE_QUERY_TYPE}");
 	next_method.replace(pos, 21, ev_query_type(ev_lambda_ref.query_type));
@@ -362,8 +407,6 @@ void {STRATEGY_ID}_CPP::build(){
 void {STRATEGY_ID}_CPP::next(){
 	if (this->exchange->__get_exchange_index() < this->warmup) { return; }
 
-    auto& operationsRef = operations; // Create a reference to operations
-
 	// define the lambda function the strategy will apply
 	{NEXT_METHOD}
 };
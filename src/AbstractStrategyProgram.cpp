@@ -0,0 +1,263 @@
+#include "pch.h"
+#include "AbstractStrategyProgram.h"
+#include "Exchange.h"
+
+#include "Asset/Asset.h"
+
+using namespace Agis;
+
+
+//============================================================================
+template <typename Opp>
+static void binary_kernel(
+	size_t n,
+	double const* lhs,
+	double const* rhs,
+	AgisStatusCode const* lhs_error,
+	AgisStatusCode const* rhs_error,
+	double* dst,
+	AgisStatusCode* dst_error,
+	Opp opp) noexcept
+{
+	// matches the tree, the right operand is evaluated first and a missing right operand makes the
+	// result missing whatever the opperation, so the left operand is never looked at
+	for (size_t i = 0; i < n; i++) {
+		bool missing = std::isnan(rhs[i]);
+		auto error = rhs_error[i] != AgisStatusCode::OK ? rhs_error[i] : (missing ? AgisStatusCode::OK : lhs_error[i]);
+		dst_error[i] = error;
+		dst[i] = (missing || error != AgisStatusCode::OK) ? AGIS_NAN : opp(lhs[i], rhs[i]);
+	}
+}
+
+
+//============================================================================
+template <typename Compare>
+static void compare_kernel(
+	size_t n,
+	double const* lhs,
+	double const* rhs,
+	AgisStatusCode const* lhs_error,
+	AgisStatusCode const* rhs_error,
+	double* dst,
+	AgisStatusCode* dst_error,
+	bool numeric_cast,
+	Compare compare) noexcept
+{
+	// the left operand is evaluated first and a missing one is returned as is. A passing compare
+	// keeps the left value (or 1.0 when cast), a failing one filters it to NaN (or 0.0)
+	double on_fail = numeric_cast ? 0.0 : AGIS_NAN;
+	for (size_t i = 0; i < n; i++) {
+		bool missing = std::isnan(lhs[i]);
+		auto error = lhs_error[i] != AgisStatusCode::OK ? lhs_error[i] : (missing ? AgisStatusCode::OK : rhs_error[i]);
+		dst_error[i] = error;
+		double pass = numeric_cast ? 1.0 : lhs[i];
+		dst[i] = (missing || error != AgisStatusCode::OK) ? AGIS_NAN : (compare(lhs[i], rhs[i]) ? pass : on_fail);
+	}
+}
+
+
+//============================================================================
+size_t AssetLambdaProgram::emit(AssetLambdaInstruction instruction)
+{
+	instruction.dst = this->registers++;
+	this->instructions.push_back(instruction);
+	return instruction.dst;
+}
+
+
+//============================================================================
+size_t AssetLambdaProgram::emit_read(size_t col_index, int row)
+{
+	AssetLambdaInstruction instruction{ AssetLambdaOpCode::READ };
+	instruction.col_index = col_index;
+	instruction.row = row;
+	return this->emit(instruction);
+}
+
+
+//============================================================================
+size_t AssetLambdaProgram::emit_observe(std::string const& observer_name)
+{
+	AssetLambdaInstruction instruction{ AssetLambdaOpCode::OBSERVE };
+	instruction.col_index = this->observer_names.size();
+	this->observer_names.push_back(observer_name);
+	return this->emit(instruction);
+}
+
+
+//============================================================================
+size_t AssetLambdaProgram::emit_constant(double value)
+{
+	AssetLambdaInstruction instruction{ AssetLambdaOpCode::CONSTANT };
+	instruction.value = value;
+	return this->emit(instruction);
+}
+
+
+//============================================================================
+size_t AssetLambdaProgram::emit_binary(AgisOpperationType opperation, size_t lhs, size_t rhs)
+{
+	AssetLambdaInstruction instruction{ AssetLambdaOpCode::BINARY };
+	instruction.opperation = opperation;
+	instruction.lhs = lhs;
+	instruction.rhs = rhs;
+	return this->emit(instruction);
+}
+
+
+//============================================================================
+size_t AssetLambdaProgram::emit_compare(AgisLogicalType logical_type, size_t lhs, size_t rhs, bool numeric_cast)
+{
+	AssetLambdaInstruction instruction{ AssetLambdaOpCode::COMPARE };
+	instruction.logical_type = logical_type;
+	instruction.lhs = lhs;
+	instruction.rhs = rhs;
+	instruction.numeric_cast = numeric_cast;
+	return this->emit(instruction);
+}
+
+
+//============================================================================
+std::expected<bool, AgisStatusCode> AssetLambdaProgram::run(
+	Exchange const* exchange,
+	std::span<AssetHandle const> assets,
+	std::span<char const> active,
+	std::span<double> out) noexcept
+{
+	auto n = assets.size();
+	if (this->instructions.empty() || active.size() < n || out.size() < n) {
+		return std::unexpected<AgisStatusCode>(AgisStatusCode::INVALID_ARGUMENT);
+	}
+	this->register_file.resize(this->registers * n);
+	this->error_file.resize(this->registers * n);
+	auto offset = exchange->__get_exchange_offset();
+
+	for (auto const& instruction : this->instructions) {
+		double* dst = this->register_file.data() + instruction.dst * n;
+		double const* lhs = this->register_file.data() + instruction.lhs * n;
+		double const* rhs = this->register_file.data() + instruction.rhs * n;
+		AgisStatusCode* dst_error = this->error_file.data() + instruction.dst * n;
+		AgisStatusCode const* lhs_error = this->error_file.data() + instruction.lhs * n;
+		AgisStatusCode const* rhs_error = this->error_file.data() + instruction.rhs * n;
+		switch (instruction.op_code) {
+			case AssetLambdaOpCode::READ: {
+				// a panel holds the current row for every asset contiguously. A panel shift steps back
+				// exchange rows rather than bars of the asset, so shifted reads always use the column.
+				auto panel_row = instruction.row == 0
+					? exchange->__get_panel_row(instruction.col_index)
+					: std::nullopt;
+				std::fill(dst_error, dst_error + n, AgisStatusCode::OK);
+				for (size_t i = 0; i < n; i++) {
+					if (!active[i]) { dst[i] = AGIS_NAN; continue; }
+					if (panel_row) {
+						dst[i] = (*panel_row)[assets[i].index - offset];
+						continue;
+					}
+					auto const& asset = *assets[i];
+					// get_current_index is the row get_asset_feature(col, 0) reads, rows outside the
+					// data are rejected as get_asset_feature rejects them
+					auto row = static_cast<long long>(asset.get_current_index()) + instruction.row;
+					if (instruction.row > 0 || row < 0) {
+						dst[i] = AGIS_NAN;
+						dst_error[i] = AgisStatusCode::INVALID_ARGUMENT;
+						continue;
+					}
+					dst[i] = asset.__get_column(instruction.col_index)[row];
+				}
+				break;
+			}
+			case AssetLambdaOpCode::OBSERVE: {
+				auto const& observer_name = this->observer_names[instruction.col_index];
+				for (size_t i = 0; i < n; i++) {
+					dst_error[i] = AgisStatusCode::OK;
+					if (!active[i]) { dst[i] = AGIS_NAN; continue; }
+					auto res = assets[i]->get_asset_observer_result(observer_name);
+					if (!res.has_value()) {
+						dst[i] = AGIS_NAN;
+						dst_error[i] = res.error();
+						continue;
+					}
+					dst[i] = res.value();
+				}
+				break;
+			}
+			case AssetLambdaOpCode::CONSTANT: {
+				std::fill(dst, dst + n, instruction.value);
+				std::fill(dst_error, dst_error + n, AgisStatusCode::OK);
+				break;
+			}
+			case AssetLambdaOpCode::BINARY: {
+				auto binary = [&](auto opp) {
+					binary_kernel(n, lhs, rhs, lhs_error, rhs_error, dst, dst_error, opp);
+				};
+				switch (instruction.opperation) {
+					case AgisOpperationType::INIT:
+						binary([](double a, double b) { return b; });
+						break;
+					case AgisOpperationType::IDENTITY:
+						binary([](double a, double b) { return a; });
+						break;
+					case AgisOpperationType::ADD:
+						binary([](double a, double b) { return a + b; });
+						break;
+					case AgisOpperationType::SUBTRACT:
+						binary([](double a, double b) { return a - b; });
+						break;
+					case AgisOpperationType::MULTIPLY:
+						binary([](double a, double b) { return a * b; });
+						break;
+					case AgisOpperationType::DIVIDE:
+						binary([](double a, double b) { return a / b; });
+						break;
+					default:
+						return std::unexpected<AgisStatusCode>(AgisStatusCode::NOT_IMPLEMENTED);
+				}
+				break;
+			}
+			case AssetLambdaOpCode::COMPARE: {
+				auto compare = [&](auto logical_compare) {
+					compare_kernel(n, lhs, rhs, lhs_error, rhs_error, dst, dst_error, instruction.numeric_cast, logical_compare);
+				};
+				switch (instruction.logical_type) {
+					case AgisLogicalType::GREATER_THAN:
+						compare([](double a, double b) { return a > b; });
+						break;
+					case AgisLogicalType::LESS_THAN:
+						compare([](double a, double b) { return a < b; });
+						break;
+					case AgisLogicalType::GREATER_THAN_EQUAL:
+						compare([](double a, double b) { return a >= b; });
+						break;
+					case AgisLogicalType::LESS_THAN_EQUAL:
+						compare([](double a, double b) { return a <= b; });
+						break;
+					case AgisLogicalType::EQUAL:
+						compare([](double a, double b) { return a == b; });
+						break;
+					case AgisLogicalType::NOT_EQUAL:
+						compare([](double a, double b) { return a != b; });
+						break;
+					default:
+						return std::unexpected<AgisStatusCode>(AgisStatusCode::NOT_IMPLEMENTED);
+				}
+				break;
+			}
+			default:
+				return std::unexpected<AgisStatusCode>(AgisStatusCode::NOT_IMPLEMENTED);
+		}
+	}
+
+	// the last instruction is the root of the tree, the tree returns the error of the first
+	// asset it evaluates that fails
+	double const* result = this->register_file.data() + this->instructions.back().dst * n;
+	AgisStatusCode const* result_error = this->error_file.data() + this->instructions.back().dst * n;
+	for (size_t i = 0; i < n; i++) {
+		if (active[i] && result_error[i] != AgisStatusCode::OK) {
+			return std::unexpected<AgisStatusCode>(result_error[i]);
+		}
+	}
+	for (size_t i = 0; i < n; i++) {
+		out[i] = active[i] ? result[i] : AGIS_NAN;
+	}
+	return true;
+}
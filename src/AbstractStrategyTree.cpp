@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "AbstractStrategyTree.h"
+#include "ExchangeMap.h"
 
 #include "Asset/Asset.h"
 
@@ -18,6 +19,27 @@ AbstractAssetLambdaLogical::AbstractAssetLambdaLogical(
 	right_node(std::move(right_node_)),
 	AbstractAssetLambdaNode(AssetLambdaType::LOGICAL)
 {
+	switch (this->logical_type) {
+		case AgisLogicalType::GREATER_THAN:
+			this->logical_compare = [](double a, double b) { return a > b; };
+			break;
+		case AgisLogicalType::LESS_THAN:
+			this->logical_compare = [](double a, double b) { return a < b; };
+			break;
+		case AgisLogicalType::GREATER_THAN_EQUAL:
+			this->logical_compare = [](double a, double b) { return a >= b; };
+			break;
+		case AgisLogicalType::LESS_THAN_EQUAL:
+			this->logical_compare = [](double a, double b) { return a <= b; };
+			break;
+		case AgisLogicalType::EQUAL:
+			this->logical_compare = [](double a, double b) { return a == b; };
+			break;
+		case AgisLogicalType::NOT_EQUAL:
+			this->logical_compare = [](double a, double b) { return a != b; };
+			break;
+	}
+
 	// set the warmup equal to the left node warmup and optionally the max of that and the right node
 	this->warmup = this->left_node->get_warmup();
 	if (std::holds_alternative<std::unique_ptr<AbstractAssetLambdaNode>>(this->right_node)) {
@@ -58,9 +80,9 @@ AbstractFutureTableNode::evaluate() const
 
 //============================================================================
 std::expected<double, AgisStatusCode>
-AbstractAssetLambdaLogical::execute(std::shared_ptr<const Asset> const& asset) const {
+AbstractAssetLambdaLogical::execute(Asset const& asset) const {
 	// execute left node to get value
-	auto res = left_node->execute();
+	auto res = left_node->execute(asset);
 	bool res_bool = false;
 	if (!res.has_value() || std::isnan(res.value())) return res;
 
@@ -73,7 +95,7 @@ AbstractAssetLambdaLogical::execute(std::shared_ptr<const Asset> const& asset) c
 	}
 	else {
 		auto& right_val_node = std::get<std::unique_ptr<AbstractAssetLambdaNode>>(this->right_node);
-		auto right_res = right_val_node->execute();
+		auto right_res = right_val_node->execute(asset);
 		if (!right_res.has_value() || std::isnan(res.value())) return right_res;
 		res_bool = this->logical_compare(res.value(), right_res.value());
 		if (!res_bool && !this->numeric_cast) res = AGIS_NAN;
@@ -86,28 +108,92 @@ AbstractAssetLambdaLogical::execute(std::shared_ptr<const Asset> const& asset) c
 }
 
 
+//============================================================================
+std::expected<size_t, AgisStatusCode>
+AbstractAssetLambdaLogical::compile(AssetLambdaProgram& program) const {
+	auto lhs = this->left_node->compile(program);
+	if (!lhs.has_value()) return lhs;
+	std::expected<size_t, AgisStatusCode> rhs;
+	if (std::holds_alternative<double>(this->right_node)) {
+		rhs = program.emit_constant(std::get<double>(this->right_node));
+	}
+	else {
+		rhs = std::get<std::unique_ptr<AbstractAssetLambdaNode>>(this->right_node)->compile(program);
+		if (!rhs.has_value()) return rhs;
+	}
+	return program.emit_compare(this->logical_type, lhs.value(), rhs.value(), this->numeric_cast);
+}
+
+
 //============================================================================
 std::expected<double, AgisStatusCode>
-AbstractAssetObserve::execute(std::shared_ptr<const Asset> const& asset) const {
-	return asset->get_asset_observer_result(this->observer_name);
+AbstractAssetObserve::execute(Asset const& asset) const {
+	return asset.get_asset_observer_result(this->observer_name);
 };
 
 
+//============================================================================
+std::expected<size_t, AgisStatusCode>
+AbstractAssetObserve::compile(AssetLambdaProgram& program) const {
+	return program.emit_observe(this->observer_name);
+}
+
+
 //============================================================================
 void
-AbstractAssetLambdaRead::set_col_index_lambda(size_t col_index) {
-	auto l = [=](std::shared_ptr<const Asset> const& asset) {
-		return asset->get_asset_feature(col_index, index.value());
+AbstractAssetLambdaRead::set_col_index_lambda(size_t col_index_) {
+	this->col_index = col_index_;
+	auto l = [=, row = index.value()](Asset const& asset) {
+		return asset.get_asset_feature(col_index_, row);
 		};
 	this->func = l;
 }
 
+
+//============================================================================
+std::expected<double, AgisStatusCode>
+AbstractAssetLambdaRead::execute(Asset const& asset) const {
+	// plain column reads are the common case, read directly instead of through func
+	if (this->col_index) return asset.get_asset_feature(*this->col_index, *this->index);
+	return this->func(asset);
+}
+
+
+//============================================================================
+std::expected<size_t, AgisStatusCode>
+AbstractAssetLambdaRead::compile(AssetLambdaProgram& program) const {
+	// reads built from a user lambda are opaque
+	if (!this->col_index) return std::unexpected<AgisStatusCode>(AgisStatusCode::NOT_IMPLEMENTED);
+	return program.emit_read(*this->col_index, *this->index);
+}
+
+
+//============================================================================
+std::expected<size_t, AgisStatusCode>
+AbstractAssetLambdaOpp::compile(AssetLambdaProgram& program) const {
+	if (!this->opperation_type) return std::unexpected<AgisStatusCode>(AgisStatusCode::NOT_IMPLEMENTED);
+	auto rhs = this->right_read->compile(program);
+	if (!rhs.has_value()) return rhs;
+	// without a left node the opperation is applied to 0 and the right node, as in execute
+	auto lhs = this->left_node
+		? this->left_node->compile(program)
+		: std::expected<size_t, AgisStatusCode>(program.emit_constant(0.0));
+	if (!lhs.has_value()) return lhs;
+	return program.emit_binary(*this->opperation_type, lhs.value(), rhs.value());
+}
+
 //============================================================================
 AGIS_API std::unique_ptr<AbstractAssetLambdaRead> create_asset_lambda_read(std::string col, int index) {
 	return std::make_unique<AbstractAssetLambdaRead>(col, index);
 }
 
 
+//============================================================================
+AGIS_API std::unique_ptr<AbstractAssetLambdaNode> create_asset_observe(std::string observer_name) {
+	return std::make_unique<AbstractAssetObserve>(observer_name);
+}
+
+
 //============================================================================
 AgisResult<bool> AbstractAssetObserve::set_warmup(const Exchange* exchange)
 {
@@ -124,19 +210,34 @@ AgisResult<bool> AbstractAssetObserve::set_warmup(const Exchange* exchange)
 //============================================================================
 std::expected<bool, AgisStatusCode>
 AbstractExchangeViewNode::execute() {
+	if (this->column_read) return this->execute_column_read();
+	if (this->program) return this->execute_program();
+	return this->execute_interpreted();
+}
+
+
+//============================================================================
+std::expected<bool, AgisStatusCode>
+AbstractExchangeViewNode::execute_interpreted() {
 	auto& view = exchange_view.view;
 
+	auto const& live_assets = this->exchange->__get_exchange_map()->__get_live_assets();
 	size_t i = 0;
 	for (auto& asset : this->assets)
 	{
-		if ((!asset || !asset->__in_exchange_view) ||
+		if ((!live_assets.test(asset.index) || !asset->__in_exchange_view) ||
 			(!asset->__is_streaming) ||
 			(asset->get_current_index() < this->warmup)) {
 			view[i].live = false;
 			i++;
 			continue;
 		}
-		auto val = this->asset_lambda_op->execute(asset);
+		if (this->zone_filter && !this->passes_zone_filter(i, *asset)) {
+			view[i].live = false;
+			i++;
+			continue;
+		}
+		auto val = this->asset_lambda_op->execute(*asset);
 		// forward any exceptions
 		if (!val.has_value()) {
 			return std::unexpected<AgisStatusCode>(val.error());
@@ -144,6 +245,7 @@ AbstractExchangeViewNode::execute() {
 		// disable asset if nan
 		if (std::isnan(val.value())) {
 			view[i].live = false;
+			i++;
 			continue;
 		}
 		auto v = val.value();
@@ -155,14 +257,132 @@ AbstractExchangeViewNode::execute() {
 }
 
 
+//============================================================================
+std::expected<bool, AgisStatusCode>
+AbstractExchangeViewNode::execute_column_read() {
+	// the exchange applies the same live, visibility and row checks as the interpreted path and
+	// drops NaN values, so the view only holds live assets
+	auto [col_index, row] = *this->column_read;
+	this->exchange_view = this->exchange->get_exchange_view(col_index, this->column_buffer, row);
+	return true;
+}
+
+
+//============================================================================
+void AbstractExchangeViewNode::reset_view()
+{
+	this->column_read = std::nullopt;
+	auto& view = this->exchange_view.view;
+	view.clear();
+	for (auto const& asset : this->assets) {
+		view.emplace_back(asset.index, 0.0, false);
+	}
+}
+
+
+//============================================================================
+std::expected<bool, AgisStatusCode>
+AbstractExchangeViewNode::run_program() {
+	auto const& live_assets = this->exchange->__get_exchange_map()->__get_live_assets();
+	auto n = this->assets.size();
+	this->active.resize(n);
+	this->values.resize(n);
+
+	// same eligibility as the interpreted path, evaluated up front into a mask
+	for (size_t i = 0; i < n; i++) {
+		auto const& asset = this->assets[i];
+		this->active[i] = live_assets.test(asset.index)
+			&& asset->__in_exchange_view
+			&& asset->__is_streaming
+			&& asset->get_current_index() >= this->warmup
+			&& (!this->zone_filter || this->passes_zone_filter(i, *asset));
+	}
+
+	return this->program->run(this->exchange, this->assets, this->active, this->values);
+}
+
+
+//============================================================================
+std::expected<bool, AgisStatusCode>
+AbstractExchangeViewNode::execute_program() {
+	auto res = this->run_program();
+	if (!res.has_value()) return res;
+
+	// disable assets that were skipped or evaluated to nan
+	auto& view = exchange_view.view;
+	for (size_t i = 0; i < this->assets.size(); i++) {
+		view[i].live = !std::isnan(this->values[i]);
+		if (view[i].live) view[i].allocation_amount = this->values[i];
+	}
+	return true;
+}
+
+
+//============================================================================
+bool AbstractExchangeViewNode::passes_zone_filter(size_t i, Asset const& asset) noexcept
+{
+	auto const& [col_index, range] = *this->zone_filter;
+	auto row = asset.get_current_index();
+	auto& state = this->zone_states[i];
+	// a decision holds for a run of rows, a reset rewinds the row below from and forces a new lookup
+	if (row < state.from || row >= state.until) {
+		state = this->zone_decision(asset, row);
+	}
+	switch (state.decision) {
+		case ZoneDecision::EXCLUDE:
+			return false;
+		case ZoneDecision::INCLUDE:
+			return true;
+		default:
+			// a NaN value is outside every range
+			return range.contains(asset.__get_column(col_index)[row]);
+	}
+}
+
+
+//============================================================================
+AbstractExchangeViewNode::ZoneState
+AbstractExchangeViewNode::zone_decision(Asset const& asset, size_t row) const noexcept
+{
+	auto const& [col_index, range] = *this->zone_filter;
+	auto zone_map = asset.__get_zone_map(col_index);
+	if (!zone_map) return ZoneState{ row, row + 1, ZoneDecision::READ };
+
+	auto block = row / zone_map->block_size;
+	auto block_end = std::min((block + 1) * zone_map->block_size, asset.get_rows());
+	double lower = zone_map->min[block];
+	double upper = zone_map->max[block];
+	if (!range.may_contain(lower, upper)) {
+		// every block up to the next one that could hold a value in range is skipped without a lookup
+		auto next = asset.__seek_zone(col_index, block_end, range.lower_bound(), range.upper_bound());
+		return ZoneState{ row, next, ZoneDecision::EXCLUDE };
+	}
+	if (range.contains_all(lower, upper) && !zone_map->has_nan[block]) {
+		return ZoneState{ row, block_end, ZoneDecision::INCLUDE };
+	}
+	return ZoneState{ row, block_end, ZoneDecision::READ };
+}
+
+
+//============================================================================
+AgisResult<bool> AbstractExchangeViewNode::set_zone_filter(std::string const& col, AssetFilterRange range)
+{
+	auto col_index = this->exchange->get_column_index(col);
+	if (col_index.is_exception()) return AgisResult<bool>(col_index.get_exception());
+	this->zone_filter = std::make_pair(col_index.unwrap(), std::move(range));
+	this->zone_states.assign(this->assets.size(), ZoneState{});
+	this->reset_view();
+	return AgisResult<bool>(true);
+}
+
+
 //============================================================================
 void AbstractExchangeViewNode::apply_asset_index_filter(std::vector<size_t> const& index_keep)
 {
 	// remove asset pointers in the node's asset list if index not in index_keep
 	for (auto asset_iter = this->assets.begin(); asset_iter != this->assets.end();)
 	{
-		auto& asset = *asset_iter;
-		size_t asset_index = asset->get_asset_index();
+		size_t asset_index = asset_iter->index;
 		auto it = std::find(index_keep.begin(), index_keep.end(), asset_index);
 		if (it != index_keep.end()) {
 			++asset_iter;
@@ -170,16 +390,9 @@ void AbstractExchangeViewNode::apply_asset_index_filter(std::vector<size_t> cons
 		};
 		asset_iter = this->assets.erase(asset_iter);
 	}
-	// pop elements from the view if index not in index_keep
-	auto& view = this->exchange_view.view;
-	for (auto& allocation : view)
-	{
-		auto it = std::find(index_keep.begin(), index_keep.end(), allocation.asset_index);
-		if (it != index_keep.end()) continue;
-		// swap to end and pop
-		std::swap(allocation, view.back());
-		view.pop_back();
-	}
+	this->zone_states.assign(this->assets.size(), ZoneState{});
+	// rebuild the view from the kept assets so view[i] stays the allocation of assets[i]
+	this->reset_view();
 }
 
 
@@ -216,7 +429,8 @@ std::unique_ptr<AbstractAssetLambdaOpp> create_asset_lambda_opp(
 	return std::make_unique<AbstractAssetLambdaOpp>(
 		std::move(left_node),
 		std::move(right_read),
-		opp
+		opp,
+		opperation
 	);
 }
 
@@ -287,6 +501,66 @@ std::unique_ptr<AbstractSortNode> create_sort_node(
 }
 
 
+//============================================================================
+AbstractCrossSectionNode::AbstractCrossSectionNode(
+	std::shared_ptr<AbstractExchangeNode> exchange_node_,
+	std::string col_,
+	CrossSectionTransform transform_,
+	double param_,
+	int row_,
+	int N_,
+	ExchangeQueryType query_type_) :
+	exchange_node(exchange_node_),
+	col(std::move(col_)),
+	transform(transform_),
+	param(param_),
+	row(row_),
+	N(N_),
+	query_type(query_type_)
+{
+	this->exchange = exchange_node->evaluate();
+	if (this->row > 0) throw std::runtime_error("Row must be <= 0");
+	auto col_index = this->exchange->get_column_index(this->col);
+	if (col_index.is_exception()) throw std::runtime_error(col_index.get_exception());
+	this->warmup = static_cast<size_t>(abs(this->row));
+}
+
+
+//============================================================================
+std::expected<ExchangeView, AgisStatusCode> AbstractCrossSectionNode::execute()
+{
+	auto res = this->exchange->get_cross_section(this->col, this->transform, this->param, this->row);
+	if (!res.has_value()) return std::unexpected<AgisStatusCode>(AgisStatusCode::INVALID_ARGUMENT);
+	// the cached view is shared with every other reader this step, select on a copy
+	ExchangeView view = *res.value();
+	auto n = (this->N < 0) ? view.view.size() : static_cast<size_t>(this->N);
+	view.sort(n, this->query_type);
+	return view;
+}
+
+
+//============================================================================
+std::unique_ptr<AbstractCrossSectionNode> create_cross_section_node(
+	std::shared_ptr<AbstractExchangeNode>& exchange_node,
+	std::string col,
+	CrossSectionTransform transform,
+	double param,
+	int row,
+	int N,
+	ExchangeQueryType query_type
+) {
+	return std::make_unique<AbstractCrossSectionNode>(
+		exchange_node,
+		std::move(col),
+		transform,
+		param,
+		row,
+		N,
+		query_type
+	);
+}
+
+
 //============================================================================
 std::unique_ptr<AbstractGenAllocationNode> create_gen_alloc_node(
 	std::unique_ptr<AbstractSortNode>& sort_node,
@@ -319,6 +593,22 @@ std::unique_ptr<AbstractGenAllocationNode> create_table_gen_alloc_node(
 }
 
 
+//============================================================================
+std::unique_ptr<AbstractGenAllocationNode> create_cross_section_gen_alloc_node(
+	std::unique_ptr<AbstractCrossSectionNode>& cross_section_node,
+	ExchangeViewOpp ev_opp_type,
+	double target,
+	std::optional<double> ev_opp_param
+) {
+	return std::make_unique<AbstractGenAllocationNode>(
+		std::move(cross_section_node),
+		ev_opp_type,
+		target,
+		ev_opp_param
+	);
+}
+
+
 //============================================================================
 std::unique_ptr<AbstractStrategyAllocationNode> create_strategy_alloc_node(
 	AgisStrategy* strategy_,
@@ -356,12 +646,12 @@ std::expected<bool, AgisStatusCode> AbstractTableViewNode::add_asset_table(std::
 std::expected<bool, AgisStatusCode>
 AbstractTableViewNode::evaluate_asset(AssetPtr const& asset, ExchangeView& v) const noexcept
 {
-	if ((!asset || !asset->__in_exchange_view) ||
+	if ((!asset->__in_exchange_view) ||
 		(!asset->__is_streaming) ||
 		(asset->get_current_index() < this->warmup)) {
 		return true;
 	}
-	auto val = this->asset_lambda_op->execute(asset);
+	auto val = this->asset_lambda_op->execute(*asset);
 	// forward any exceptions
 	if (!val.has_value()) {
 		return std::unexpected<AgisStatusCode>(val.error());
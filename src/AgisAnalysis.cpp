@@ -1,6 +1,7 @@
 #include "pch.h"
 #include <numeric>
 #include "AgisAnalysis.h"
+#include "AgisKernels.h"
 #include "Portfolio.h"
 #include "AgisStrategy.h"
 
@@ -32,17 +33,11 @@ double get_stats_annualized_pct_returns(std::vector<double> const& nlv_history)
 //============================================================================
 double get_stats_annualized_volatility(std::vector<double> const& nlv_history)
 {
-    // calculate annualized volatility
-    auto days = nlv_history.size();
-    auto years = days / 252.0;
-    auto daily_returns = std::vector<double>(days - 1);
-    for (size_t i = 0; i < days - 1; i++)
-    {
-        daily_returns[i] = (nlv_history[i + 1] - nlv_history[i]) / nlv_history[i];
-    }
-    auto mean = std::accumulate(daily_returns.begin(), daily_returns.end(), 0.0) / daily_returns.size();
-    auto sq_sum = std::inner_product(daily_returns.begin(), daily_returns.end(), daily_returns.begin(), 0.0);
-    auto stdev = std::sqrt(sq_sum / daily_returns.size() - mean * mean);
+    // calculate annualized volatility from the population std of the daily returns
+    if (nlv_history.size() < 2) return 0.0;
+    std::vector<double> daily_returns(nlv_history.size());
+    Agis::Kernels::pct_change(nlv_history, daily_returns);
+    auto stdev = std::sqrt(Agis::Kernels::variance(std::span<double const>(daily_returns).subspan(1), 0));
     return 100 * stdev * std::sqrt(252);
 }
 
@@ -113,28 +108,19 @@ AgisResult<double> get_stats_beta(std::vector<double> const& nlv_history, std::v
 		return AgisResult<double>(AGIS_EXCEP("nlv_history and benchmark_nlv_history must have the same size"));
 	}
 
-    double covariance = 0.0;
-    double benchmark_variance = 0.0;
-
-    double nlv_mean = 0.0;
-    double benchmark_mean = 0.0;
-
-    for (size_t i = 1; i < nlv_history.size(); ++i) {
-        double nlv_return = (i > 0) ? (nlv_history[i] - nlv_history[i - 1]) / nlv_history[i - 1] : 0.0;
-        double benchmark_return = (i > 0) ? (benchmark_nlv_history[i] - benchmark_nlv_history[i - 1]) / benchmark_nlv_history[i - 1] : 0.0;
-
-        nlv_mean += nlv_return;
-        benchmark_mean += benchmark_return;
-
-        covariance += nlv_return * benchmark_return;
-        benchmark_variance += benchmark_return * benchmark_return;
+    if (nlv_history.size() < 3)
+    {
+        return AgisResult<double>(AGIS_EXCEP("nlv_history must have at least 3 entries"));
     }
 
-    nlv_mean /= nlv_history.size();
-    benchmark_mean /= benchmark_nlv_history.size();
-
-    double beta = (covariance - nlv_mean * benchmark_mean * nlv_history.size()) /
-        (benchmark_variance - benchmark_mean * benchmark_mean * nlv_history.size());
+    std::vector<double> nlv_returns(nlv_history.size());
+    std::vector<double> benchmark_returns(benchmark_nlv_history.size());
+    Agis::Kernels::pct_change(nlv_history, nlv_returns);
+    Agis::Kernels::pct_change(benchmark_nlv_history, benchmark_returns);
+    double beta = Agis::Kernels::beta(
+        std::span<double const>(nlv_returns).subspan(1),
+        std::span<double const>(benchmark_returns).subspan(1)
+    );
 
     return AgisResult<double>(beta);
 }
@@ -146,36 +132,22 @@ std::vector<double> get_rolling_sharpe(
     size_t window_size,
     double risk_free)
 {
-    std::vector<double> returns;
     std::vector<double> rolling_sharpe_ratios;
-
-    double rolling_avg_return = 0.0;
-    double rolling_std_dev_sum = 0.0;
-
-    for (size_t i = 1; i <= nlv_history.size(); ++i) {
-        double current_return = (nlv_history[i] - nlv_history[i - 1]) / nlv_history[i - 1];
-        returns.push_back(current_return);
-
-        rolling_avg_return += current_return;
-        rolling_std_dev_sum += current_return * current_return;
-
-        if (i >= window_size) {
-            if (i > window_size) {
-                double removed_return = (nlv_history[i - window_size] - nlv_history[i - window_size - 1])
-                    / nlv_history[i - window_size - 1];
-                rolling_avg_return -= removed_return;
-                rolling_std_dev_sum -= removed_return * removed_return;
-            }
-
-            double avg_return = rolling_avg_return / window_size;
-            double std_dev = std::sqrt((rolling_std_dev_sum - window_size * avg_return * avg_return) / (window_size - 1));
-
-            double annualized_avg_return = avg_return * 252; // Assuming 252 trading days in a year
-            double annualized_std_dev = std_dev * std::sqrt(252); // Annualize standard deviation
-
-            double sharpe_ratio = (annualized_avg_return - risk_free) / annualized_std_dev;
-            rolling_sharpe_ratios.push_back(sharpe_ratio);
-        }
+    if (window_size < 2 || nlv_history.size() <= window_size) return rolling_sharpe_ratios;
+
+    // rolling mean and sample std of the returns in a single pass
+    std::vector<double> returns(nlv_history.size());
+    Agis::Kernels::pct_change(nlv_history, returns);
+    auto return_span = std::span<double const>(returns).subspan(1);
+    std::vector<double> rolling_mean(return_span.size());
+    std::vector<double> rolling_var(return_span.size());
+    Agis::Kernels::rolling_moments(return_span, window_size, rolling_mean, rolling_var);
+
+    rolling_sharpe_ratios.reserve(return_span.size() - window_size + 1);
+    for (size_t i = window_size - 1; i < return_span.size(); ++i) {
+        double annualized_avg_return = rolling_mean[i] * 252; // Assuming 252 trading days in a year
+        double annualized_std_dev = std::sqrt(rolling_var[i]) * std::sqrt(252); // Annualize standard deviation
+        rolling_sharpe_ratios.push_back((annualized_avg_return - risk_free) / annualized_std_dev);
     }
     return rolling_sharpe_ratios;
 }
@@ -0,0 +1,499 @@
+#include "pch.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "AgisKernels.h"
+
+// MSVC exposes the AVX2 intrinsics without /arch:AVX2 so the vector path is always compiled
+// and selected at runtime. Other compilers only get it when building for AVX2.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+#define AGIS_KERNELS_AVX2
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define AGIS_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+
+
+namespace Agis
+{
+
+namespace Kernels
+{
+
+namespace
+{
+
+constexpr double AGIS_KERNEL_NAN = std::numeric_limits<double>::quiet_NaN();
+
+
+//============================================================================
+/**
+ * @brief Neumaier compensated running sum, tracks the low order bits lost by each addition
+*/
+struct CompensatedSum
+{
+	double sum = 0.0;
+	double c = 0.0;
+
+	inline void add(double v) noexcept {
+		double t = sum + v;
+		if (std::abs(sum) >= std::abs(v)) c += (sum - t) + v;
+		else c += (v - t) + sum;
+		sum = t;
+	}
+
+	inline double value() const noexcept { return sum + c; }
+};
+
+
+//============================================================================
+/**
+ * @brief first value in the series that is not NaN, used to shift the data before accumulating
+*/
+double first_finite(std::span<double const> x) noexcept
+{
+	for (auto v : x) {
+		if (!std::isnan(v)) return v;
+	}
+	return 0.0;
+}
+
+
+//============================================================================
+/**
+ * @brief d[i] = (x[i] - k) - (x[i - w] - k), with the window not yet full d[i] = x[i] - k
+*/
+void window_delta(double const* x, size_t n, size_t w, double k, double* d) noexcept
+{
+	size_t head = std::min(w, n);
+	for (size_t i = 0; i < head; i++) {
+		d[i] = x[i] - k;
+	}
+	size_t i = head;
+#ifdef AGIS_KERNELS_AVX2
+	if (has_avx2()) {
+		for (; i + 4 <= n; i += 4) {
+			__m256d a = _mm256_loadu_pd(x + i);
+			__m256d b = _mm256_loadu_pd(x + i - w);
+			_mm256_storeu_pd(d + i, _mm256_sub_pd(a, b));
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		d[i] = x[i] - x[i - w];
+	}
+}
+
+
+//============================================================================
+/**
+ * @brief d[i] = (x[i] - kx)(y[i] - ky) - (x[i - w] - kx)(y[i - w] - ky)
+*/
+void window_delta_product(
+	double const* x,
+	double const* y,
+	size_t n,
+	size_t w,
+	double kx,
+	double ky,
+	double* d) noexcept
+{
+	size_t head = std::min(w, n);
+	for (size_t i = 0; i < head; i++) {
+		d[i] = (x[i] - kx) * (y[i] - ky);
+	}
+	size_t i = head;
+#ifdef AGIS_KERNELS_AVX2
+	if (has_avx2()) {
+		__m256d vkx = _mm256_set1_pd(kx);
+		__m256d vky = _mm256_set1_pd(ky);
+		for (; i + 4 <= n; i += 4) {
+			__m256d xa = _mm256_sub_pd(_mm256_loadu_pd(x + i), vkx);
+			__m256d ya = _mm256_sub_pd(_mm256_loadu_pd(y + i), vky);
+			__m256d xb = _mm256_sub_pd(_mm256_loadu_pd(x + i - w), vkx);
+			__m256d yb = _mm256_sub_pd(_mm256_loadu_pd(y + i - w), vky);
+			__m256d a = _mm256_mul_pd(xa, ya);
+			__m256d b = _mm256_mul_pd(xb, yb);
+			_mm256_storeu_pd(d + i, _mm256_sub_pd(a, b));
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		d[i] = (x[i] - kx) * (y[i] - ky) - (x[i - w] - kx) * (y[i - w] - ky);
+	}
+}
+
+
+//============================================================================
+/**
+ * @brief in place compensated prefix scan of window deltas into window sums
+*/
+void window_scan(double* d, size_t n, size_t w) noexcept
+{
+	CompensatedSum s;
+	for (size_t i = 0; i < n; i++) {
+		s.add(d[i]);
+		d[i] = (i + 1 >= w) ? s.value() : AGIS_KERNEL_NAN;
+	}
+}
+
+
+//============================================================================
+void scale(double* x, size_t n, double factor) noexcept
+{
+	size_t i = 0;
+#ifdef AGIS_KERNELS_AVX2
+	if (has_avx2()) {
+		__m256d f = _mm256_set1_pd(factor);
+		for (; i + 4 <= n; i += 4) {
+			_mm256_storeu_pd(x + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), f));
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		x[i] *= factor;
+	}
+}
+
+
+//============================================================================
+/**
+ * @brief Welford pass over x (and y when Bivariate), four lanes at a time on AVX2. Every lane has
+ * seen the same number of values so the 1/n factor is shared.
+*/
+template <bool Bivariate>
+Moments moments_impl(double const* x, double const* y, size_t n) noexcept
+{
+	Moments total;
+	size_t i = 0;
+#ifdef AGIS_KERNELS_AVX2
+	if (has_avx2() && n >= 8) {
+		__m256d mx = _mm256_setzero_pd();
+		__m256d my = _mm256_setzero_pd();
+		__m256d m2x = _mm256_setzero_pd();
+		__m256d m2y = _mm256_setzero_pd();
+		__m256d cxy = _mm256_setzero_pd();
+		size_t lane_count = 0;
+		for (; i + 4 <= n; i += 4) {
+			lane_count++;
+			__m256d inv = _mm256_set1_pd(1.0 / static_cast<double>(lane_count));
+			__m256d vx = _mm256_loadu_pd(x + i);
+			__m256d dx = _mm256_sub_pd(vx, mx);
+			mx = _mm256_add_pd(mx, _mm256_mul_pd(dx, inv));
+			m2x = _mm256_add_pd(m2x, _mm256_mul_pd(dx, _mm256_sub_pd(vx, mx)));
+			if constexpr (Bivariate) {
+				__m256d vy = _mm256_loadu_pd(y + i);
+				__m256d dy = _mm256_sub_pd(vy, my);
+				my = _mm256_add_pd(my, _mm256_mul_pd(dy, inv));
+				__m256d ry = _mm256_sub_pd(vy, my);
+				m2y = _mm256_add_pd(m2y, _mm256_mul_pd(dy, ry));
+				cxy = _mm256_add_pd(cxy, _mm256_mul_pd(dx, ry));
+			}
+		}
+
+		alignas(32) double lanes[5][4];
+		_mm256_store_pd(lanes[0], mx);
+		_mm256_store_pd(lanes[1], my);
+		_mm256_store_pd(lanes[2], m2x);
+		_mm256_store_pd(lanes[3], m2y);
+		_mm256_store_pd(lanes[4], cxy);
+		for (size_t l = 0; l < 4; l++) {
+			Moments lane;
+			lane.n = lane_count;
+			lane.mean_x = lanes[0][l];
+			lane.mean_y = lanes[1][l];
+			lane.m2_x = lanes[2][l];
+			lane.m2_y = lanes[3][l];
+			lane.c_xy = lanes[4][l];
+			total.merge(lane);
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		if constexpr (Bivariate) total.add(x[i], y[i]);
+		else total.add(x[i]);
+	}
+	return total;
+}
+
+}
+
+
+//============================================================================
+bool has_avx2() noexcept
+{
+#if defined(AGIS_KERNELS_AVX2) && defined(_MSC_VER)
+	static const bool supported = []() {
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx) return false;
+		// make sure the os saves the ymm registers on context switch
+		if ((_xgetbv(0) & 0x6) != 0x6) return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}();
+	return supported;
+#elif defined(AGIS_KERNELS_AVX2)
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+//============================================================================
+void rolling_sum(std::span<double const> x, size_t window, std::span<double> out) noexcept
+{
+	if (window == 0 || x.size() < window) {
+		std::fill(out.begin(), out.end(), AGIS_KERNEL_NAN);
+		return;
+	}
+	window_delta(x.data(), x.size(), window, 0.0, out.data());
+	window_scan(out.data(), x.size(), window);
+}
+
+
+//============================================================================
+void rolling_cross_sum(
+	std::span<double const> x,
+	std::span<double const> y,
+	size_t window,
+	std::span<double> out) noexcept
+{
+	if (window == 0 || x.size() < window || y.size() < x.size()) {
+		std::fill(out.begin(), out.end(), AGIS_KERNEL_NAN);
+		return;
+	}
+	window_delta_product(x.data(), y.data(), x.size(), window, 0.0, 0.0, out.data());
+	window_scan(out.data(), x.size(), window);
+}
+
+
+//============================================================================
+void rolling_mean(std::span<double const> x, size_t window, std::span<double> out) noexcept
+{
+	rolling_sum(x, window, out);
+	if (window == 0 || x.size() < window) return;
+	scale(out.data(), x.size(), 1.0 / static_cast<double>(window));
+}
+
+
+//============================================================================
+void rolling_moments(
+	std::span<double const> x,
+	size_t window,
+	std::span<double> mean_out,
+	std::span<double> var_out) noexcept
+{
+	auto n = x.size();
+	if (window == 0 || n < window) {
+		std::fill(mean_out.begin(), mean_out.end(), AGIS_KERNEL_NAN);
+		std::fill(var_out.begin(), var_out.end(), AGIS_KERNEL_NAN);
+		return;
+	}
+
+	// shift by the first value so the sums stay small relative to the spread
+	double k = first_finite(x);
+	window_delta(x.data(), n, window, k, mean_out.data());
+	window_delta_product(x.data(), x.data(), n, window, k, k, var_out.data());
+
+	double w = static_cast<double>(window);
+	CompensatedSum s1;
+	CompensatedSum s2;
+	for (size_t i = 0; i < n; i++) {
+		s1.add(mean_out[i]);
+		s2.add(var_out[i]);
+		if (i + 1 < window) {
+			mean_out[i] = AGIS_KERNEL_NAN;
+			var_out[i] = AGIS_KERNEL_NAN;
+			continue;
+		}
+		double sum = s1.value();
+		double sos = s2.value();
+		mean_out[i] = k + sum / w;
+		if (window < 2) {
+			var_out[i] = AGIS_KERNEL_NAN;
+			continue;
+		}
+		double var = (sos - sum * sum / w) / (w - 1.0);
+		var_out[i] = var > 0.0 ? var : 0.0;
+	}
+}
+
+
+//============================================================================
+void rolling_variance(std::span<double const> x, size_t window, std::span<double> out) noexcept
+{
+	std::vector<double> mean(x.size());
+	rolling_moments(x, window, mean, out);
+}
+
+
+//============================================================================
+void rolling_zscore(std::span<double const> x, size_t window, std::span<double> out) noexcept
+{
+	std::vector<double> var(x.size());
+	rolling_moments(x, window, out, var);
+	for (size_t i = 0; i < x.size(); i++) {
+		double m = out[i];
+		double v = var[i];
+		if (std::isnan(m) || std::isnan(v) || v <= 0.0) {
+			out[i] = AGIS_KERNEL_NAN;
+			continue;
+		}
+		out[i] = (x[i] - m) / std::sqrt(v);
+	}
+}
+
+
+//============================================================================
+void pct_change(std::span<double const> x, std::span<double> out) noexcept
+{
+	auto n = x.size();
+	if (!n) return;
+	out[0] = 0.0;
+	size_t i = 1;
+#ifdef AGIS_KERNELS_AVX2
+	if (has_avx2()) {
+		__m256d one = _mm256_set1_pd(1.0);
+		for (; i + 4 <= n; i += 4) {
+			__m256d a = _mm256_loadu_pd(x.data() + i);
+			__m256d b = _mm256_loadu_pd(x.data() + i - 1);
+			_mm256_storeu_pd(out.data() + i, _mm256_sub_pd(_mm256_div_pd(a, b), one));
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		out[i] = x[i] / x[i - 1] - 1.0;
+	}
+}
+
+
+//============================================================================
+void rolling_beta(
+	std::span<double const> x,
+	std::span<double const> market,
+	size_t window,
+	std::span<double> out) noexcept
+{
+	auto n = x.size();
+	if (window < 2 || n < window || market.size() < n) {
+		std::fill(out.begin(), out.end(), AGIS_KERNEL_NAN);
+		return;
+	}
+
+	// shift both series so the cross sums stay small relative to the spread
+	double kx = first_finite(x);
+	double ky = first_finite(market);
+	std::vector<double> dx(n);
+	std::vector<double> dy(n);
+	std::vector<double> dyy(n);
+	window_delta(x.data(), n, window, kx, dx.data());
+	window_delta(market.data(), n, window, ky, dy.data());
+	window_delta_product(market.data(), market.data(), n, window, ky, ky, dyy.data());
+	window_delta_product(x.data(), market.data(), n, window, kx, ky, out.data());
+
+	double w = static_cast<double>(window);
+	CompensatedSum sx;
+	CompensatedSum sy;
+	CompensatedSum syy;
+	CompensatedSum sxy;
+	for (size_t i = 0; i < n; i++) {
+		sx.add(dx[i]);
+		sy.add(dy[i]);
+		syy.add(dyy[i]);
+		sxy.add(out[i]);
+		if (i + 1 < window) {
+			out[i] = AGIS_KERNEL_NAN;
+			continue;
+		}
+		double sum_y = sy.value();
+		double cov = sxy.value() - sx.value() * sum_y / w;
+		double var = syy.value() - sum_y * sum_y / w;
+		out[i] = var > 0.0 ? cov / var : AGIS_KERNEL_NAN;
+	}
+}
+
+
+//============================================================================
+Moments moments(std::span<double const> x) noexcept
+{
+	return moments_impl<false>(x.data(), nullptr, x.size());
+}
+
+
+//============================================================================
+Moments moments(std::span<double const> x, std::span<double const> y) noexcept
+{
+	return moments_impl<true>(x.data(), y.data(), std::min(x.size(), y.size()));
+}
+
+
+//============================================================================
+double mean(std::span<double const> x) noexcept
+{
+	if (x.empty()) return AGIS_KERNEL_NAN;
+	return moments(x).mean_x;
+}
+
+
+//============================================================================
+double variance(std::span<double const> x, size_t ddof) noexcept
+{
+	return moments(x).variance_x(ddof);
+}
+
+
+//============================================================================
+double covariance(std::span<double const> x, std::span<double const> y, size_t ddof) noexcept
+{
+	return moments(x, y).covariance(ddof);
+}
+
+
+//============================================================================
+double correlation(std::span<double const> x, std::span<double const> y) noexcept
+{
+	return moments(x, y).correlation();
+}
+
+
+//============================================================================
+double beta(std::span<double const> x, std::span<double const> market) noexcept
+{
+	return moments(x, market).beta();
+}
+
+
+//============================================================================
+void batch_moments(std::span<std::span<double const> const> series, std::span<Moments> out) noexcept
+{
+	auto n = std::min(series.size(), out.size());
+	for (size_t i = 0; i < n; i++) {
+		out[i] = moments(series[i]);
+	}
+}
+
+
+//============================================================================
+void batch_beta(
+	std::span<std::span<double const> const> series,
+	std::span<double const> market,
+	std::span<double> out) noexcept
+{
+	auto n = std::min(series.size(), out.size());
+	for (size_t i = 0; i < n; i++) {
+		out[i] = series[i].size() == market.size() ? beta(series[i], market) : AGIS_KERNEL_NAN;
+	}
+}
+
+}
+
+}
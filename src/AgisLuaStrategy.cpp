@@ -59,7 +59,42 @@ void init_lua_enums(sol::state& lua)
 	);
 	lua.new_enum<AssetObserverType>("AssetObserverType",
 		{
-			{"COL_ROL_MEAN", AssetObserverType::COL_ROL_MEAN}
+			{"COL_ROL_MEAN", AssetObserverType::COL_ROL_MEAN},
+			{"COL_ROL_VAR", AssetObserverType::COL_ROL_VAR},
+			{"COL_ROL_ZSCORE", AssetObserverType::COL_ROL_ZSCORE},
+			{"COL_ROL_COV", AssetObserverType::COL_ROL_COV},
+			{"COL_EWMA_MEAN", AssetObserverType::COL_EWMA_MEAN},
+			{"COL_EWMA_VAR", AssetObserverType::COL_EWMA_VAR},
+			{"COL_ROL_MIN", AssetObserverType::COL_ROL_MIN},
+			{"COL_ROL_MAX", AssetObserverType::COL_ROL_MAX},
+			{"COL_ROL_ARGMIN", AssetObserverType::COL_ROL_ARGMIN},
+			{"COL_ROL_ARGMAX", AssetObserverType::COL_ROL_ARGMAX},
+			{"COL_ROL_RANK", AssetObserverType::COL_ROL_RANK},
+			{"COL_ROL_MEDIAN", AssetObserverType::COL_ROL_MEDIAN},
+			{"COL_ROL_QUANTILE", AssetObserverType::COL_ROL_QUANTILE},
+			{"COL_ROL_OLS", AssetObserverType::COL_ROL_OLS}
+		}
+	);
+	lua.new_enum<OLSOutput>("OLSOutput",
+		{
+			{"ALPHA", OLSOutput::ALPHA},
+			{"BETA", OLSOutput::BETA},
+			{"R2", OLSOutput::R2},
+			{"RESIDUAL", OLSOutput::RESIDUAL}
+		}
+	);
+	lua.new_enum<AssetObserverMode>("AssetObserverMode",
+		{
+			{"PRECOMPUTE", AssetObserverMode::PRECOMPUTE},
+			{"STREAMING", AssetObserverMode::STREAMING}
+		}
+	);
+	lua.new_enum<CrossSectionTransform>("CrossSectionTransform",
+		{
+			{"RANK", CrossSectionTransform::RANK},
+			{"DEMEAN", CrossSectionTransform::DEMEAN},
+			{"ZSCORE", CrossSectionTransform::ZSCORE},
+			{"WINSORISE", CrossSectionTransform::WINSORISE}
 		}
 	);
 	lua.new_enum<TableExtractMethod>("TableExtractMethod",
@@ -86,11 +121,19 @@ void init_lua_interface(sol::state* lua_ptr) {
 		sol::no_constructor
 	);
 	lua.new_usertype<AbstractExchangeViewNode>("AbstractExchangeViewNode",
-		sol::no_constructor
+		sol::no_constructor,
+		"is_compiled", &AbstractExchangeViewNode::is_compiled,
+		"set_zone_filter", [](AbstractExchangeViewNode& node, std::string const& col, std::string const& range) {
+			auto res = node.set_zone_filter(col, AssetFilterRange(range));
+			if (res.is_exception()) AGIS_THROW(res.get_exception());
+		}
 	);
 	lua.new_usertype<AbstractSortNode>("AbstractSortNode",
 				sol::no_constructor
 	);
+	lua.new_usertype<AbstractCrossSectionNode>("AbstractCrossSectionNode",
+		sol::no_constructor
+	);
 	lua.new_usertype<AbstractGenAllocationNode>("AbstractGenAllocationNode",
 		sol::no_constructor,
 		"set_vol_target", &AbstractGenAllocationNode::set_vol_target,
@@ -102,6 +145,7 @@ void init_lua_interface(sol::state* lua_ptr) {
 
 	//lua.set_function("create_asset_lambda_filter", create_asset_lambda_filter);
 	lua.set_function("create_asset_lambda_read", create_asset_lambda_read);
+	lua.set_function("create_asset_observe", create_asset_observe);
 	lua.set_function("create_asset_lambda_opp", create_asset_lambda_opp);
 	lua.set_function("create_future_view_node", create_future_view_node);
 	lua.set_function("create_exchange_node", create_exchange_node);
@@ -109,6 +153,8 @@ void init_lua_interface(sol::state* lua_ptr) {
 	lua.set_function("create_gen_alloc_node", create_gen_alloc_node);
 	lua.set_function("create_table_gen_alloc_node", create_table_gen_alloc_node);
 	lua.set_function("create_sort_node", create_sort_node);
+	lua.set_function("create_cross_section_node", create_cross_section_node);
+	lua.set_function("create_cross_section_gen_alloc_node", create_cross_section_gen_alloc_node);
 	lua.set_function("create_strategy_alloc_node", create_strategy_alloc_node);
 
 	// Register the AgisResult template and its methods and constructors
@@ -142,19 +188,112 @@ void init_lua_interface(sol::state* lua_ptr) {
 		AGIS_TRY(type = va[0].as<AssetObserverType>();)
 		switch (type)
 		{
-		case AssetObserverType::COL_ROL_MEAN: {
+		case AssetObserverType::COL_ROL_MEAN:
+		case AssetObserverType::COL_ROL_VAR:
+		case AssetObserverType::COL_ROL_ZSCORE:
+		case AssetObserverType::COL_EWMA_MEAN:
+		case AssetObserverType::COL_EWMA_VAR:
+		case AssetObserverType::COL_ROL_MIN:
+		case AssetObserverType::COL_ROL_MAX:
+		case AssetObserverType::COL_ROL_ARGMIN:
+		case AssetObserverType::COL_ROL_ARGMAX:
+		case AssetObserverType::COL_ROL_RANK:
+		case AssetObserverType::COL_ROL_MEDIAN: {
 			if (va.size() != 3) AGIS_THROW("invalid number of arguments");
 			std::string col;
 			size_t window;
 			AGIS_TRY(col = va[1].as<std::string>();)
 			AGIS_TRY(window = va[2].as<size_t>();)
-			exchange_add_observer(
+			auto res = exchange_add_observer(
 				exchange,
+				[&](Asset const*) { return roll_col_observer_key(type, col, window); },
 				create_roll_col_observer,
-				AssetObserverType::COL_ROL_MEAN,
+				type,
 				col,
+				window,
+				exchange->get_observer_mode()
+			);
+			if (res.is_exception()) AGIS_THROW(res.get_exception());
+			break;
+		}
+		case AssetObserverType::COL_ROL_QUANTILE: {
+			if (va.size() != 4) AGIS_THROW("invalid number of arguments");
+			std::string col;
+			size_t window;
+			double quantile;
+			AGIS_TRY(col = va[1].as<std::string>();)
+			AGIS_TRY(window = va[2].as<size_t>();)
+			AGIS_TRY(quantile = va[3].as<double>();)
+			auto res = exchange_add_observer(
+				exchange,
+				[&](Asset const*) { return roll_quantile_observer_key(col, window, quantile); },
+				create_roll_quantile_observer,
+				col,
+				window,
+				quantile
+			);
+			if (res.is_exception()) AGIS_THROW(res.get_exception());
+			break;
+		}
+		case AssetObserverType::COL_ROL_OLS: {
+			// univariate regression of a column on a column of a reference asset
+			if (va.size() != 6) AGIS_THROW("invalid number of arguments");
+			std::string y_col;
+			std::string ref_asset_id;
+			std::string x_col;
+			size_t window;
+			OLSOutput output;
+			AGIS_TRY(y_col = va[1].as<std::string>();)
+			AGIS_TRY(ref_asset_id = va[2].as<std::string>();)
+			AGIS_TRY(x_col = va[3].as<std::string>();)
+			AGIS_TRY(window = va[4].as<size_t>();)
+			AGIS_TRY(output = va[5].as<OLSOutput>();)
+			auto ref_asset = exchange->__get_exchange_map()->get_asset(ref_asset_id);
+			if (ref_asset.is_exception()) AGIS_THROW(ref_asset.get_exception());
+			std::vector<OLSRegressor> regressors = { OLSRegressor{ ref_asset.unwrap().get(), x_col } };
+			size_t beta_index = 0;
+			// the regression is shared by every output requested over the same columns and window
+			auto res = exchange_add_observer(
+				exchange,
+				[&](Asset const* asset) { return roll_ols_observer_key(asset, y_col, regressors, window); },
+				create_roll_ols_observer,
+				y_col,
+				regressors,
 				window
 			);
+			if (res.is_exception()) AGIS_THROW(res.get_exception());
+			res = exchange_add_observer(
+				exchange,
+				[&](Asset const* asset) {
+					return roll_ols_output_key(asset, y_col, regressors, window, output, beta_index);
+				},
+				create_roll_ols_output_observer,
+				y_col,
+				regressors,
+				window,
+				output,
+				beta_index
+			);
+			if (res.is_exception()) AGIS_THROW(res.get_exception());
+			break;
+		}
+		case AssetObserverType::COL_ROL_COV: {
+			if (va.size() != 4) AGIS_THROW("invalid number of arguments");
+			std::string col_a;
+			std::string col_b;
+			size_t window;
+			AGIS_TRY(col_a = va[1].as<std::string>();)
+			AGIS_TRY(col_b = va[2].as<std::string>();)
+			AGIS_TRY(window = va[3].as<size_t>();)
+			auto res = exchange_add_observer(
+				exchange,
+				[&](Asset const*) { return roll_cov_observer_key(col_a, col_b, window); },
+				create_roll_cov_observer,
+				col_a,
+				col_b,
+				window
+			);
+			if (res.is_exception()) AGIS_THROW(res.get_exception());
 			break;
 		}
 		default:
@@ -167,7 +306,12 @@ void init_lua_interface(sol::state* lua_ptr) {
 	lua.new_usertype<Exchange>("Exchange",
 		sol::no_constructor,
 		"get_exchange_id" , &Exchange::get_exchange_id,
-		"add_observer", exchange_add_observer_lambda
+		"add_observer", exchange_add_observer_lambda,
+		"set_observer_mode", &Exchange::set_observer_mode,
+		"build_zone_maps", [](Exchange& exchange, std::string const& col, sol::optional<size_t> block_size) {
+			auto res = exchange.build_zone_maps(col, block_size.value_or(256));
+			if (res.is_exception()) AGIS_THROW(res.get_exception());
+		}
 	);
 
 	// Bind the AgisStrategy class with no constructors.
@@ -1,5 +1,7 @@
 #include "pch.h"
+#include <algorithm>
 #include "AgisRisk.h"
+#include "AgisKernels.h"
 #include "Order.h"
 #include "ExchangeMap.h"
 #include "AgisStrategy.h"
@@ -11,118 +13,87 @@ using namespace Agis;
 constexpr auto SQRT_252 = 15.874507866387544;
 
 //============================================================================
-double covariance(const std::vector<double>& values1, const std::vector<double>& values2, size_t start, size_t end)
+const char* CovarianceEstimatorToString(CovarianceEstimator estimator)
 {
-    double sum = 0.0;
-    size_t n = end - start;
-
-    for (size_t i = start; i < end; i++)
-    {
-        sum += (values1[i] - mean(values1, start, end)) * (values2[i] - mean(values2, start, end));
+    switch (estimator) {
+    case CovarianceEstimator::SAMPLE: return "SAMPLE";
+    case CovarianceEstimator::LEDOIT_WOLF: return "LEDOIT_WOLF";
+    case CovarianceEstimator::FACTOR: return "FACTOR";
+    default: return nullptr;
     }
-
-    return sum / static_cast<double>(n - 1);
 }
 
 
 //============================================================================
-double variance(const std::vector<double>& values, size_t start, size_t end)
+std::expected<CovarianceEstimator, AgisException> StringToCovarianceEstimator(std::string const& estimator)
 {
-    double sum = 0.0;
-    size_t n = end - start;
+    if (estimator == "SAMPLE") return CovarianceEstimator::SAMPLE;
+    if (estimator == "LEDOIT_WOLF") return CovarianceEstimator::LEDOIT_WOLF;
+    if (estimator == "FACTOR") return CovarianceEstimator::FACTOR;
+    return std::unexpected<AgisException>(AGIS_EXCEP("invalid covariance estimator: " + estimator));
+}
 
-    for (size_t i = start; i < end; i++)
-    {
-        sum += std::pow(values[i] - mean(values, start, end), 2);
-    }
 
-    return sum / static_cast<double>(n - 1);
+//============================================================================
+double covariance(const std::vector<double>& values1, const std::vector<double>& values2, size_t start, size_t end)
+{
+    return Agis::Kernels::covariance(
+        std::span<double const>(values1).subspan(start, end - start),
+        std::span<double const>(values2).subspan(start, end - start)
+    );
 }
 
 
 //============================================================================
-double mean(const std::vector<double>& values, size_t start, size_t end)
+double variance(const std::vector<double>& values, size_t start, size_t end)
 {
-    double sum = 0.0;
+    return Agis::Kernels::variance(std::span<double const>(values).subspan(start, end - start));
+}
 
-    for (size_t i = start; i < end; i++)
-    {
-        sum += values[i];
-    }
 
-    return sum / static_cast<double>(end - start);
+//============================================================================
+double mean(const std::vector<double>& values, size_t start, size_t end)
+{
+    return Agis::Kernels::mean(std::span<double const>(values).subspan(start, end - start));
 }
 
 
 //============================================================================
 double mean(const double* values, size_t start, size_t end)
 {
-    double sum = 0.0;
-
-    for (size_t i = start; i < end; i++)
-    {
-        sum += values[i];
-    }
-
-    return sum / static_cast<double>(end - start);
+    return Agis::Kernels::mean(std::span<double const>(values + start, end - start));
 }
 
 //============================================================================
 double correlation(const std::vector<double>& values1, const std::vector<double>& values2, size_t start, size_t end)
 {
-    double cov = covariance(values1, values2, start, end);
-    double var1 = variance(values1, start, end);
-    double var2 = variance(values2, start, end);
-
-    return cov / (std::sqrt(var1) * std::sqrt(var2));
+    return Agis::Kernels::correlation(
+        std::span<double const>(values1).subspan(start, end - start),
+        std::span<double const>(values2).subspan(start, end - start)
+    );
 }
 
 
 //============================================================================
 std::vector<double> rolling_beta(const std::vector<double>& stock_returns, const std::vector<double>& market_returns, size_t window_size)
 {
-    // works for now. Slightly off from pands rolling beta, probably ddof difference
-    // matches python: 
-    //cov = sum(df_mid["returns_SPY"].head(252) * df_mid[f"returns_{ticker}"].head(252))
-    //var = sum(df_mid["returns_SPY"].head(252) * df_mid["returns_SPY"].head(252))
-    //beta= cov/var
-
-    size_t data_size = stock_returns.size();
-
     // beta is calculated with returns, to make sure the beta vector is the same length
-    // as the the asset's row count, insert 0 at the beginning
-    std::vector<double> rolling_betas; // Initialize with zeros
-    rolling_betas.reserve(data_size + 1);
-    rolling_betas.push_back(0.0);
-
-    double rolling_covariance = 0.0;
-    double rolling_market_variance = 0.0;
-
-    // Calculate initial covariance and market variance
-    for (size_t i = 0; i < window_size; ++i) {
-        rolling_covariance += stock_returns[i] * market_returns[i];
-        rolling_market_variance += market_returns[i] * market_returns[i];
-        rolling_betas.push_back(0.0f);
-    }
-
-    // note, note window_size - 1 because of the fact that we are using returns, 
-    // the first real element will be at the index location: window_size
-    rolling_betas[window_size] = rolling_covariance / rolling_market_variance;
-
-    // Update covariance and variance incrementally
-    for (size_t i = window_size; i < data_size; ++i) {
-        double old_stock_return = stock_returns[i - window_size];
-        double old_market_return = market_returns[i - window_size];
-
-        double new_stock_return = stock_returns[i];
-        double new_market_return = market_returns[i];
-
-        rolling_covariance += (new_stock_return * new_market_return - old_stock_return * old_market_return);
-        rolling_market_variance += (new_market_return * new_market_return - old_market_return * old_market_return);
-
-        rolling_betas.push_back(rolling_covariance / rolling_market_variance);
+    // as the the asset's row count, insert 0 at the beginning. Note window_size - 1 because 
+    // of the fact that we are using returns, the first real element will be at index window_size
+    size_t data_size = stock_returns.size();
+    std::vector<double> rolling_betas(data_size + 1, 0.0);
+    if (window_size == 0 || data_size < window_size) return rolling_betas;
+
+    // demeaned cov / var over each window, matches pandas rolling cov / rolling var
+    Agis::Kernels::rolling_beta(
+        stock_returns,
+        market_returns,
+        window_size,
+        std::span<double>(rolling_betas).subspan(1)
+    );
+    for (auto& b : rolling_betas) {
+        if (std::isnan(b)) b = 0.0;
     }
-
     return rolling_betas;
 }
 
@@ -140,38 +111,20 @@ std::vector<double> rolling_volatility(std::span<const double> const prices, siz
 
     // volatility is calculated with returns, to make sure the vol vector is the same length
     // as the the asset's row count, insert 0 at the beginning
-    rolling_volatility.reserve(prices.size());
-    rolling_volatility.push_back(0.0);
-
-    double sum = 0.0;
-    double sos = 0.0;
-
-    // Calculate the initial sums for the first window
-    for (size_t i = 1; i < window_size; ++i) {
-        double returnVal = (prices[i] - prices[i - 1]) / prices[i - 1];
-        sum += returnVal;
-        sos += returnVal * returnVal;
-        rolling_volatility.push_back(0.0f);
+    std::vector<double> returns(prices.size());
+    Agis::Kernels::pct_change(prices, returns);
+    rolling_volatility.resize(prices.size(), 0.0);
+    if (prices.size() < 2) return rolling_volatility;
+
+    // rolling sample variance over the window of returns ending at each row
+    Agis::Kernels::rolling_variance(
+        std::span<double const>(returns).subspan(1),
+        window_size,
+        std::span<double>(rolling_volatility).subspan(1)
+    );
+    for (auto& v : rolling_volatility) {
+        v = std::isnan(v) ? 0.0 : std::sqrt(v) * SQRT_252;
     }
-
-    for (size_t i = window_size; i < prices.size(); ++i) {
-        // Calculate the rolling standard deviation (volatility) for the current window.
-        double returnVal = (prices[i] - prices[i - 1]) / prices[i - 1];
-        sum += returnVal;
-        sos += returnVal * returnVal;
-        double mean = sum / (window_size);
-        double variance = (sos / (window_size-1)) - (mean * mean);
-        double volatility = std::sqrt(variance) * SQRT_252;
-
-        rolling_volatility.push_back(volatility);
-
-        if (i > window_size) {
-            double old_return = (prices[i - window_size] - prices[i - window_size - 1]) / prices[i - window_size - 1];
-            sum -= old_return;
-            sos -= old_return * old_return;
-        }
-    }
-
     return rolling_volatility;
 }
 
@@ -192,6 +145,39 @@ std::expected<double, AgisException> calculate_portfolio_volatility(
 }
 
 
+//============================================================================
+std::expected<double, AgisException> calculate_portfolio_volatility(
+    VectorXd const& portfolio_weights,
+    AgisCovarianceMatrix const& covariance_matrix
+)
+{
+    if (static_cast<size_t>(portfolio_weights.size()) != covariance_matrix.get_asset_count()) {
+        return std::unexpected<AgisException>(AGIS_EXCEP("Weights vector size does not match covariance matrix size"));
+    }
+    return std::sqrt(covariance_matrix.portfolio_variance(portfolio_weights) * 252);
+}
+
+
+//============================================================================
+std::expected<double, AgisException> calculate_portfolio_volatility(
+    std::span<size_t const> asset_indices,
+    VectorXd const& portfolio_weights,
+    AgisCovarianceMatrix const& covariance_matrix,
+    AgisCovarianceBlock& cache
+)
+{
+    if (static_cast<size_t>(portfolio_weights.size()) != asset_indices.size()) {
+        return std::unexpected<AgisException>(AGIS_EXCEP("Weights vector size does not match asset index count"));
+    }
+    for (auto i : asset_indices) {
+        if (i >= covariance_matrix.get_asset_count()) {
+            return std::unexpected<AgisException>(AGIS_EXCEP("Asset index out of covariance matrix range"));
+        }
+    }
+    return std::sqrt(covariance_matrix.portfolio_variance(asset_indices, portfolio_weights, cache) * 252);
+}
+
+
 //============================================================================
 void AgisRiskStruct::__build(AgisStrategy const* parent_strategy_)
 {
@@ -255,66 +241,383 @@ AgisCovarianceMatrix::AgisCovarianceMatrix(
     size_t step_size_
 )
 {
+    if (lookback_ < 2) throw std::runtime_error("covariance lookback must be at least 2");
+    if (step_size_ == 0) throw std::runtime_error("covariance step size must be greater than 0");
     this->lookback = lookback_;
     this->step_size = step_size_;
     this->exchange_map = exchange_map;
 
+    // assets without enough data to fill a window are never sampled and keep a covariance of 0
     auto& assets = exchange_map->get_assets();
-    auto asset_count = assets.size();
-    this->covariance_matrix.resize(asset_count, asset_count);
-    this->covariance_matrix.setZero();
+    this->tracked.resize(assets.size());
+    for (size_t i = 0; i < assets.size(); i++)
+    {
+        auto& asset = assets[i];
+        this->tracked[i] = asset && asset->__get_vol_close_column().size() > lookback;
+        if (this->tracked[i]) asset->__set_warmup(this->lookback * this->step_size);
+    }
+    this->reset();
+    this->enabled = true;
+}
+
+
+//============================================================================
+void AgisCovarianceMatrix::reset() noexcept
+{
+    auto asset_count = this->tracked.size();
+    this->returns_window.setZero(this->lookback, asset_count);
+    this->mask_window.setZero(this->lookback, asset_count);
+
+    // the factored form never materialises anything N x N
+    size_t dense_count = this->is_factored() ? 0 : asset_count;
+    this->covariance_matrix.setZero(dense_count, dense_count);
+    this->sum_xy.setZero(dense_count, dense_count);
+    this->sum_x.setZero(dense_count, dense_count);
+    this->count.setZero(dense_count, dense_count);
+    this->removed_returns.setZero(dense_count ? this->lookback : 0, dense_count);
+    this->removed_mask.setZero(dense_count ? this->lookback : 0, dense_count);
+    if (!this->user_loadings) this->factor_loadings.setZero(asset_count, this->factor_count);
+    this->factor_covariance.setZero(this->factor_count, this->factor_count);
+    this->specific_variance.setZero(asset_count);
+    this->last_price.setConstant(asset_count, std::numeric_limits<double>::quiet_NaN());
+    this->step_count = 0;
+    this->samples = 0;
+    this->head = 0;
+    this->pending = 0;
+    this->pending_removed = 0;
+    this->samples_since_recompute = 0;
+    this->dirty = false;
+    this->generation++;
+}
+
+
+//============================================================================
+void AgisCovarianceMatrix::apply_pending() const noexcept
+{
+    if (!this->pending) return;
+    if (this->pending >= this->lookback || this->samples_since_recompute + this->pending >= this->lookback) {
+        this->recompute_sums();
+        return;
+    }
+
+    // the pending samples are the last p rows written to the ring buffer
+    auto asset_count = this->returns_window.cols();
+    auto p = static_cast<Eigen::Index>(this->pending);
+    MatrixXd added_returns(p, asset_count);
+    MatrixXd added_mask(p, asset_count);
+    for (Eigen::Index i = 0; i < p; i++) {
+        auto row = (this->head + this->lookback - this->pending + i) % this->lookback;
+        added_returns.row(i) = this->returns_window.row(row);
+        added_mask.row(i) = this->mask_window.row(row);
+    }
+    this->sum_xy.noalias() += added_returns.transpose() * added_returns;
+    this->sum_x.noalias() += added_returns.transpose() * added_mask;
+    this->count.noalias() += added_mask.transpose() * added_mask;
+
+    if (this->pending_removed) {
+        auto r = static_cast<Eigen::Index>(this->pending_removed);
+        auto removed_r = this->removed_returns.topRows(r);
+        auto removed_m = this->removed_mask.topRows(r);
+        this->sum_xy.noalias() -= removed_r.transpose() * removed_r;
+        this->sum_x.noalias() -= removed_r.transpose() * removed_m;
+        this->count.noalias() -= removed_m.transpose() * removed_m;
+    }
+    this->samples_since_recompute += this->pending;
+    this->pending = 0;
+    this->pending_removed = 0;
+}
+
+
+//============================================================================
+void AgisCovarianceMatrix::recompute_sums() const noexcept
+{
+    this->sum_xy.noalias() = this->returns_window.transpose() * this->returns_window;
+    this->sum_x.noalias() = this->returns_window.transpose() * this->mask_window;
+    this->count.noalias() = this->mask_window.transpose() * this->mask_window;
+    this->samples_since_recompute = 0;
+    this->pending = 0;
+    this->pending_removed = 0;
+}
+
+
+//============================================================================
+void AgisCovarianceMatrix::materialise() const noexcept
+{
+    auto c = this->count.array();
+    auto centered = this->sum_xy.array() - this->sum_x.array() * this->sum_x.transpose().array() / c;
+    this->covariance_matrix = (c >= 1.5).select(centered / (c - 1.0), 0.0);
+}
+
+
+//============================================================================
+void AgisCovarianceMatrix::step() noexcept
+{
+    if (!this->enabled) return;
+    if (++this->step_count % this->step_size != 0) return;
 
-    // build the incremental covariance matrix
+    auto& assets = this->exchange_map->get_assets();
+    auto asset_count = this->tracked.size();
+    if (assets.size() != asset_count) return;
+
+    // sample the return of every asset that has a bar at the current time
+    VectorXd returns = VectorXd::Zero(asset_count);
+    VectorXd mask = VectorXd::Zero(asset_count);
+    auto t = this->exchange_map->__get_market_time();
     for (size_t i = 0; i < asset_count; i++)
     {
-        for (size_t j = 0; j < i + 1; j++)
-        {
-            if (
-                assets[i]->__get_vol_close_column().size() <= lookback
-                ||
-                assets[j]->__get_vol_close_column().size() <= lookback
-                ) continue;
-            std::shared_ptr<IncrementalCovariance> incremental_covariance;
-            try {
-                auto observer = create_inc_cov_observer(
-                    assets[i],
-                    assets[j]
-                );
-                if(!observer.has_value()) throw observer.error();
-                incremental_covariance = std::dynamic_pointer_cast<IncrementalCovariance>(observer.value());
+        if (!this->tracked[i] || !this->exchange_map->__is_live(i)) continue;
+        auto& asset = assets[i];
+        if (!asset->__is_streaming || asset->__get_asset_time(true) != t) continue;
+        double price = asset->__get_market_price(true);
+        double prev = this->last_price(i);
+        this->last_price(i) = price;
+        if (std::isnan(prev) || prev == 0.0 || std::isnan(price)) continue;
+        returns(i) = price / prev - 1.0;
+        mask(i) = 1.0;
+    }
+
+    // keep the sample leaving the window so it can be removed from the sums when next read,
+    // not needed once a full window is pending as the sums are then recomputed
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    bool track_removed = !this->is_factored() && this->pending < this->lookback;
+    if (this->samples >= this->lookback && track_removed)
+    {
+        this->removed_returns.row(this->pending_removed) = this->returns_window.row(this->head);
+        this->removed_mask.row(this->pending_removed) = this->mask_window.row(this->head);
+        this->pending_removed++;
+    }
+    this->returns_window.row(this->head) = returns.transpose();
+    this->mask_window.row(this->head) = mask.transpose();
+    this->head = (this->head + 1) % this->lookback;
+    this->samples++;
+    this->pending++;
+    this->generation++;
+    this->dirty = true;
+}
+
+
+//============================================================================
+void AgisCovarianceMatrix::ensure_current() const noexcept
+{
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    if (!this->dirty) return;
+    if (this->is_factored()) {
+        this->fit_factor_model();
+        this->pending = 0;
+    }
+    else {
+        this->apply_pending();
+        this->materialise();
+        if (this->estimator == CovarianceEstimator::LEDOIT_WOLF) this->apply_shrinkage();
+    }
+    this->dirty = false;
+}
+
+
+//============================================================================
+void AgisCovarianceMatrix::compute_sub_block(std::span<size_t const> indices, MatrixXd& block) const noexcept
+{
+    auto k = static_cast<Eigen::Index>(indices.size());
+    block.resize(k, k);
+    if (this->is_factored()) {
+        MatrixXd loadings(k, this->factor_loadings.cols());
+        for (Eigen::Index i = 0; i < k; i++) {
+            loadings.row(i) = this->factor_loadings.row(indices[i]);
+        }
+        block = loadings * this->factor_covariance * loadings.transpose();
+        for (Eigen::Index i = 0; i < k; i++) {
+            block(i, i) += this->specific_variance(indices[i]);
+        }
+    }
+    else if (this->estimator == CovarianceEstimator::LEDOIT_WOLF) {
+        for (Eigen::Index i = 0; i < k; i++) {
+            for (Eigen::Index j = 0; j < k; j++) {
+                block(i, j) = this->covariance_matrix(indices[i], indices[j]);
             }
-            catch (std::runtime_error& e) {
-			    throw e;
-			}
-            auto upper_triangular = &this->covariance_matrix(i, j);
-            auto lower_triangular = &this->covariance_matrix(j, i);
-            incremental_covariance->set_pointers(upper_triangular, lower_triangular);
-            incremental_covariance->set_step_size(this->step_size);
-            incremental_covariance->set_period(this->lookback);
-            incremental_covariance_matrix.push_back(incremental_covariance);
-		}
+        }
     }
-    this->built = true;
+    else {
+        // gather the columns of the window and compute the pairwise covariance of just this block
+        MatrixXd r(this->returns_window.rows(), k);
+        MatrixXd m(this->mask_window.rows(), k);
+        for (Eigen::Index i = 0; i < k; i++) {
+            r.col(i) = this->returns_window.col(indices[i]);
+            m.col(i) = this->mask_window.col(indices[i]);
+        }
+        MatrixXd sxy = r.transpose() * r;
+        MatrixXd sx = r.transpose() * m;
+        MatrixXd c = m.transpose() * m;
+        auto ca = c.array();
+        block = (ca >= 1.5).select((sxy.array() - sx.array() * sx.transpose().array() / ca) / (ca - 1.0), 0.0);
+    }
+}
+
+
+//============================================================================
+void AgisCovarianceMatrix::refresh_sub_block(std::span<size_t const> indices, AgisCovarianceBlock& cache) const noexcept
+{
+    if (cache.generation == this->generation && std::ranges::equal(indices, cache.indices)) return;
+    // the sample block is built straight from the window, the other estimators need the fit
+    if (this->estimator != CovarianceEstimator::SAMPLE) this->ensure_current();
+    this->compute_sub_block(indices, cache.block);
+    cache.indices.assign(indices.begin(), indices.end());
+    cache.generation = this->generation;
 }
 
 
 //============================================================================
-void AgisCovarianceMatrix::set_asset_observers() noexcept
+MatrixXd AgisCovarianceMatrix::get_sub_matrix(std::span<size_t const> indices) const noexcept
 {
-    for (auto& m : this->incremental_covariance_matrix) {
-        if (!m->enclosing_asset) continue;
-        m->add_observer();
+    if (this->estimator != CovarianceEstimator::SAMPLE) this->ensure_current();
+    MatrixXd block;
+    this->compute_sub_block(indices, block);
+    return block;
+}
+
+
+//============================================================================
+double AgisCovarianceMatrix::portfolio_variance(
+    std::span<size_t const> indices,
+    VectorXd const& weights,
+    AgisCovarianceBlock& cache) const noexcept
+{
+    this->refresh_sub_block(indices, cache);
+    return weights.dot(cache.block * weights);
+}
+
+
+//============================================================================
+double AgisCovarianceMatrix::operator()(size_t i, size_t j) const noexcept
+{
+    this->ensure_current();
+    if (!this->is_factored()) return this->covariance_matrix(i, j);
+    double res = this->factor_loadings.row(i) * this->factor_covariance * this->factor_loadings.row(j).transpose();
+    if (i == j) res += this->specific_variance(i);
+    return res;
+}
+
+
+//============================================================================
+double AgisCovarianceMatrix::portfolio_variance(VectorXd const& weights) const noexcept
+{
+    this->ensure_current();
+    if (!this->is_factored()) return weights.dot(this->covariance_matrix * weights);
+    VectorXd exposure = this->factor_loadings.transpose() * weights;
+    return exposure.dot(this->factor_covariance * exposure)
+        + (weights.array().square() * this->specific_variance.array()).sum();
+}
+
+
+//============================================================================
+std::expected<bool, AgisException>
+AgisCovarianceMatrix::set_estimator(CovarianceEstimator estimator_, size_t factor_count_) noexcept
+{
+    if (estimator_ == CovarianceEstimator::FACTOR && !this->user_loadings) {
+        if (factor_count_ == 0 || factor_count_ >= this->lookback) {
+            return std::unexpected<AgisException>(AGIS_EXCEP("factor count must be in (0, lookback)"));
+        }
+        this->factor_count = factor_count_;
+    }
+    if (estimator_ != CovarianceEstimator::FACTOR) {
+        this->user_loadings = false;
+        this->factor_count = 0;
+    }
+    this->estimator = estimator_;
+    this->reset();
+    return true;
+}
+
+
+//============================================================================
+std::expected<bool, AgisException>
+AgisCovarianceMatrix::set_factor_loadings(MatrixXd loadings) noexcept
+{
+    if (static_cast<size_t>(loadings.rows()) != this->tracked.size() || loadings.cols() == 0) {
+        return std::unexpected<AgisException>(AGIS_EXCEP("factor loadings must be N x k"));
     }
-    this->built = true;
+    this->factor_count = loadings.cols();
+    this->factor_loadings = std::move(loadings);
+    this->user_loadings = true;
+    this->estimator = CovarianceEstimator::FACTOR;
+    this->reset();
+    return true;
+}
+
+
+//============================================================================
+MatrixXd AgisCovarianceMatrix::centered_window() const noexcept
+{
+    VectorXd counts = this->mask_window.colwise().sum().transpose();
+    VectorXd means = this->returns_window.colwise().sum().transpose().cwiseQuotient(counts.cwiseMax(1.0));
+    MatrixXd x = this->returns_window - this->mask_window * means.asDiagonal();
+    return x;
+}
+
+
+//============================================================================
+void AgisCovarianceMatrix::apply_shrinkage() const noexcept
+{
+    size_t t = std::min(this->samples, this->lookback);
+    auto n = this->covariance_matrix.rows();
+    if (t < 2 || n == 0) return;
+
+    // Ledoit & Wolf (2004), shrinkage target mu * I with mu the average variance
+    MatrixXd x = this->centered_window();
+    auto const& s = this->covariance_matrix;
+    double mu = s.trace() / n;
+    double delta = (s - mu * MatrixXd::Identity(n, n)).squaredNorm() / n;
+    if (delta <= 0.0) return;
+
+    // sum_t ||x_t x_t' - S||^2 = sum_t ||x_t||^4 - 2 sum_t x_t' S x_t + t ||S||^2
+    double row_norms = x.rowwise().squaredNorm().array().square().sum();
+    double cross = ((x * s).array() * x.array()).sum();
+    double beta_bar = (row_norms - 2.0 * cross + t * s.squaredNorm()) / (static_cast<double>(t) * t * n);
+    double shrinkage = std::clamp(beta_bar / delta, 0.0, 1.0);
+
+    this->covariance_matrix *= (1.0 - shrinkage);
+    this->covariance_matrix.diagonal().array() += shrinkage * mu;
 }
 
 
 //============================================================================
-void AgisCovarianceMatrix::clear_observers() noexcept
+void AgisCovarianceMatrix::fit_factor_model() const noexcept
 {
-    for (auto& m : this->incremental_covariance_matrix) {
-        if(!m->enclosing_asset) continue;
-        m->remove_observer();
+    size_t t = std::min(this->samples, this->lookback);
+    if (t <= this->factor_count || t < 2) return;
+    double scale = 1.0 / std::sqrt(static_cast<double>(t - 1));
+    MatrixXd x = this->centered_window() * scale;
+    VectorXd total_variance = x.colwise().squaredNorm().transpose();
+    auto k = static_cast<Eigen::Index>(this->factor_count);
+
+    if (!this->user_loadings) {
+        // principal components from the (lookback x lookback) gram matrix so nothing N x N is formed
+        MatrixXd gram = x * x.transpose();
+        SelfAdjointEigenSolver<MatrixXd> solver(gram);
+        if (solver.info() != Eigen::Success) return;
+        auto const& values = solver.eigenvalues();
+        auto const& vectors = solver.eigenvectors();
+        this->factor_covariance.setZero(k, k);
+        for (Eigen::Index j = 0; j < k; j++) {
+            // eigen values are sorted ascending, take the largest k
+            auto col = gram.rows() - 1 - j;
+            double lambda = std::max(values(col), 0.0);
+            this->factor_covariance(j, j) = lambda;
+            if (lambda > 0.0) this->factor_loadings.col(j) = x.transpose() * vectors.col(col) / std::sqrt(lambda);
+            else this->factor_loadings.col(j).setZero();
+        }
+        VectorXd common = (this->factor_loadings.array().square().matrix() * this->factor_covariance.diagonal());
+        this->specific_variance = (total_variance - common).cwiseMax(0.0);
+        return;
     }
-    this->built = false;
+
+    // user supplied loadings, factor returns from a least squares projection of each sample
+    auto const& b = this->factor_loadings;
+    MatrixXd btb = b.transpose() * b;
+    auto ldlt = btb.ldlt();
+    if (ldlt.info() != Eigen::Success) return;
+    MatrixXd factor_returns = ldlt.solve(b.transpose() * x.transpose()).transpose();
+    this->factor_covariance = factor_returns.transpose() * factor_returns;
+    MatrixXd residual = x - factor_returns * b.transpose();
+    residual.array() *= this->mask_window.array();
+    this->specific_variance = residual.colwise().squaredNorm().transpose();
 }
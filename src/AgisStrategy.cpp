@@ -245,7 +245,7 @@ AGIS_API void AgisStrategy::strategy_allocate(
 {
 	//if (this->apply_beta_scale) AGIS_DO_OR_THROW(exchange_view.beta_scale());
 	if (this->apply_beta_hedge) AGIS_DO_OR_THROW(exchange_view.beta_hedge(this->alloc_target));
-	if (this->alloc_type_target == AllocTypeTarget::VOL) AGIS_DO_OR_THROW(exchange_view.vol_target(this->alloc_target.value()));
+	if (this->alloc_type_target == AllocTypeTarget::VOL) AGIS_DO_OR_THROW(exchange_view.vol_target(this->alloc_target.value(), this->allocation_covariance));
 
 	auto& allocation = exchange_view.view;
 
@@ -254,9 +254,8 @@ AGIS_API void AgisStrategy::strategy_allocate(
 	{
 		if (!alloc.live) continue;
 		size_t asset_index = alloc.asset_index;
-		auto asset_opt = this->exchange_map->get_asset(asset_index);
-		if(asset_opt.is_exception()) throw AgisException(asset_opt.get_exception());
-		auto asset = asset_opt.unwrap();
+		if (asset_index >= this->exchange_map->get_asset_count()) AGIS_THROW("asset was not found");
+		auto asset = this->exchange_map->__get_asset_ptr(asset_index);
 		double size = alloc.allocation_amount;
 		switch (alloc_type)
 		{
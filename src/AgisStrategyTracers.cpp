@@ -110,14 +110,24 @@ AgisStrategyTracers::get_portfolio_volatility()
 	}
 
 	// set the portfolio weights to the trades, note the vector already has the nlv of the trades.
-	// so all we have to do is divide by the nlv to get the pct portfolio weights
+	// so all we have to do is divide by the nlv to get the pct portfolio weights. Only the held
+	// assets are gathered so the covariance matrix only has to produce that sub-block.
+	std::vector<size_t> held_indices;
+	held_indices.reserve(this->strategy->trades.size());
 	for (auto& [asset_index, trade] : this->strategy->trades)
 	{
 		this->portfolio_weights(asset_index) /= this->nlv;
+		held_indices.push_back(asset_index);
+	}
+	VectorXd held_weights(held_indices.size());
+	for (size_t i = 0; i < held_indices.size(); i++) {
+		held_weights(i) = this->portfolio_weights(held_indices[i]);
 	}
 
 	// calculate vol using the covariance matrix
-	auto res = calculate_portfolio_volatility(this->portfolio_weights, cov_matrix.unwrap()->get_eigen_matrix());
+	auto res = calculate_portfolio_volatility(
+		held_indices, held_weights, *cov_matrix.unwrap(), this->holdings_covariance
+	);
 	if (!res.has_value()) return res;
 	this->portfolio_volatility.store(res.value());
 	return res;
@@ -138,8 +148,7 @@ AgisStrategyTracers::get_benchmark_volatility()
 	}
 
 	auto bench_strategy = static_cast<BenchMarkStrategy*>(this->strategy);
-	auto& eigen_matrix = cov_matrix.unwrap()->get_eigen_matrix();
-	auto variance = eigen_matrix(bench_strategy->asset_index, bench_strategy->asset_index);
+	auto variance = cov_matrix.unwrap()->variance(bench_strategy->asset_index);
 	
 	this->portfolio_volatility = std::sqrt(variance * 252);
 	return this->portfolio_volatility;
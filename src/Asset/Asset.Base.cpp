@@ -110,6 +110,7 @@ AgisResult<bool> Asset::load(
 
     this->close = this->data.data() + (this->rows) * this->close_index;
     this->open = this->data.data() + (this->rows) * this->open_index;
+    this->invalidate_observers();
     return AgisResult<bool>(true);
 }
 
@@ -186,6 +187,7 @@ AgisResult<bool> Asset::load(
     this->close = this->data.data() + (this->rows) * this->close_index;
     this->open = this->data.data() + (this->rows) * this->open_index;
     this->is_loaded = true;
+    this->invalidate_observers();
     return AgisResult<bool>(true);
 }
 #endif
@@ -244,10 +246,21 @@ void Asset::add_observer(AssetObserver* observer)
     if (it == this->observers.end())
     {
         this->observers.emplace(std::move(str_rep), observer);
+        this->observer_dispatch_valid = false;
     }
     else
     {
-        (*it).second->set_touch(true);
+        (*it).second->__acquire();
+    }
+}
+
+
+//============================================================================
+void Asset::invalidate_observers() noexcept
+{
+    for (auto& [name, observer] : this->observers) {
+        auto col_observer = dynamic_cast<DataFrameColObserver*>(observer);
+        if (col_observer) col_observer->__invalidate();
     }
 }
 
@@ -255,11 +268,12 @@ void Asset::add_observer(AssetObserver* observer)
 //============================================================================
 void Asset::remove_observer(AssetObserver* observer)
 {
-    // remove observer if it exists
-    auto str_rep = observer->str_rep();
-    if (this->observers.contains(str_rep))
+    // remove observer if it exists, only if it is the instance registered under its str_rep
+    auto it = this->observers.find(observer->str_rep());
+    if (it != this->observers.end() && (*it).second == observer)
     {
-        this->observers.erase(str_rep);
+        this->observers.erase(it);
+        this->observer_dispatch_valid = false;
     }
 }
 
@@ -498,50 +512,121 @@ std::vector<std::string> Asset::__get_dt_index_str(bool adjust_for_warmup) const
 }
 
 
+//============================================================================
+AgisResult<bool> Asset::__build_zone_map(size_t column_index, size_t block_size)
+{
+    if (column_index >= this->columns) return AgisResult<bool>(AGIS_EXCEP("invalid column index"));
+    if (block_size == 0) return AgisResult<bool>(AGIS_EXCEP("zone map block size must be positive"));
+
+    auto column = this->__get_column(column_index);
+    size_t blocks = (this->rows + block_size - 1) / block_size;
+    ZoneMap zone_map;
+    zone_map.block_size = block_size;
+    zone_map.min.assign(blocks, std::numeric_limits<double>::infinity());
+    zone_map.max.assign(blocks, -std::numeric_limits<double>::infinity());
+    zone_map.has_nan.assign(blocks, false);
+    for (size_t i = 0; i < this->rows; i++)
+    {
+        double v = column[i];
+        auto block = i / block_size;
+        if (std::isnan(v)) {
+            zone_map.has_nan[block] = true;
+            continue;
+        }
+        zone_map.min[block] = std::min(zone_map.min[block], v);
+        zone_map.max[block] = std::max(zone_map.max[block], v);
+    }
+    this->zone_maps[column_index] = std::move(zone_map);
+    return AgisResult<bool>(true);
+}
+
+
+//============================================================================
+std::optional<std::pair<double, double>> Asset::__get_zone(size_t column_index, size_t row) const noexcept
+{
+    auto it = this->zone_maps.find(column_index);
+    if (it == this->zone_maps.end() || row >= this->rows) return std::nullopt;
+    auto block = row / it->second.block_size;
+    return std::make_pair(it->second.min[block], it->second.max[block]);
+}
+
+
+//============================================================================
+ZoneMap const* Asset::__get_zone_map(size_t column_index) const noexcept
+{
+    auto it = this->zone_maps.find(column_index);
+    if (it == this->zone_maps.end()) return nullptr;
+    return &it->second;
+}
+
+
+//============================================================================
+size_t Asset::__seek_zone(size_t column_index, size_t row, double lower, double upper) const noexcept
+{
+    auto it = this->zone_maps.find(column_index);
+    if (it == this->zone_maps.end()) return row;
+    auto const& zone_map = it->second;
+    for (auto block = row / zone_map.block_size; block < zone_map.min.size(); block++)
+    {
+        if (zone_map.max[block] < lower || zone_map.min[block] > upper) continue;
+        return std::max(row, block * zone_map.block_size);
+    }
+    return this->rows;
+}
+
+
 //============================================================================
 bool Asset::__set_beta(AssetPtr market_asset, size_t lookback)
 {
-    auto market_close_col_index = market_asset->__get_close_index();
-    auto market_close_col = market_asset->__get_column(market_close_col_index);
-    auto close_column = this->__get_column(this->close_index);
+    return this->__set_beta(
+        market_asset->__get_dt_index(false),
+        market_asset->__get_column(market_asset->__get_close_index()),
+        lookback
+    );
+}
+
 
+//============================================================================
+bool Asset::__set_beta(
+    std::span<long long const> market_dt_index,
+    std::span<double const> market_close,
+    size_t lookback)
+{
+    auto close_column = this->__get_column(this->close_index);
     if (lookback >= close_column.size())
     {
         return false;
     }
-
-    // adjust the warmup to account for the lookback period
-    this->__set_warmup(lookback);
-
-    auto market_datetime_index = market_asset->__get_dt_index(false);
     auto datetime_index = this->__get_dt_index(false);
-    long long first_datetime = datetime_index[0];
 
     // find the first datetime in the market asset that is equal to the first datetime in this asset
-    auto first_datetime_index = std::find(
-        market_datetime_index.begin(),
-        market_datetime_index.end(),
-        first_datetime
-    );
-    // get this index location
-    auto first_datetime_index_loc = std::distance(
-        market_datetime_index.begin(),
-        first_datetime_index
-    );
+    auto first = std::lower_bound(market_dt_index.begin(), market_dt_index.end(), datetime_index[0]);
+    if (first == market_dt_index.end() || *first != datetime_index[0])
+    {
+        return false;
+    }
+
+    // adjust the warmup to account for the lookback period
+    this->__set_warmup(lookback);
 
     std::vector<double> returns_this, returns_market;
     returns_this.resize(this->rows - 1);
     returns_market.resize(this->rows - 1);
 
-    // Calculate the daily returns for both this asset and the market asset
+    // Calculate the daily returns for both this asset and the market asset. The market return
+    // is taken over the same interval as the asset's so gaps in this asset are compounded
+    size_t market_prev = std::distance(market_dt_index.begin(), first);
+    size_t market_row = market_prev;
     for (size_t i = 1; i < this->rows; i++)
     {
-        double return_this = (close_column[i] - close_column[i - 1]) / close_column[i - 1];
-        double return_market = (market_close_col[i + first_datetime_index_loc] - market_close_col[i + first_datetime_index_loc - 1]) /
-            market_close_col[i + first_datetime_index_loc - 1];
-
-        returns_this[i - 1] = return_this;
-        returns_market[i - 1] = return_market;
+        while (market_row < market_dt_index.size() && market_dt_index[market_row] < datetime_index[i]) market_row++;
+        if (market_row == market_dt_index.size() || market_dt_index[market_row] != datetime_index[i])
+        {
+            return false;
+        }
+        returns_this[i - 1] = close_column[i] / close_column[i - 1] - 1.0;
+        returns_market[i - 1] = market_close[market_row] / market_close[market_prev] - 1.0;
+        market_prev = market_row;
     }
     this->beta_vector = rolling_beta(returns_this, returns_market, lookback);
     assert(this->beta_vector.size() == this->rows);
@@ -663,6 +748,17 @@ void Asset::__step()
     if (this->__in_warmup()) this->__is_streaming = false;
     else this->__is_streaming = true;
 
+    // exchange has flattened the observers into contiguous per type tables
+    if (this->observer_dispatch_valid) {
+        for (auto observer : this->col_observer_span) {
+            observer->__advance();
+        }
+        for (auto observer : this->observer_span) {
+            observer->on_step();
+        }
+        return;
+    }
+
     if (this->observers.size()) {
         for (auto& observer : observers) {
             observer.second->on_step();
@@ -1,9 +1,14 @@
 
 #pragma once
 #include <cmath>
+#include <cassert>
+#include <format>
 #include <memory>
+#include <algorithm>
 #include <stdexcept>
+#include <Eigen/Dense>
 #include "AgisException.h"
+#include "AgisKernels.h"
 
 #include "Asset/Asset.Base.h"
 #include "Asset/Asset.Observer.h"
@@ -38,6 +43,28 @@ std::string AssetObserverTypeToString(AssetObserverType type)
         return "COL_ROL_VAR";
     case AssetObserverType::COL_ROL_ZSCORE:
         return "COL_ROL_ZSCORE";
+    case AssetObserverType::COL_ROL_COV:
+        return "COL_ROL_COV";
+    case AssetObserverType::COL_EWMA_MEAN:
+        return "COL_EWMA_MEAN";
+    case AssetObserverType::COL_EWMA_VAR:
+        return "COL_EWMA_VAR";
+    case AssetObserverType::COL_ROL_MIN:
+        return "COL_ROL_MIN";
+    case AssetObserverType::COL_ROL_MAX:
+        return "COL_ROL_MAX";
+    case AssetObserverType::COL_ROL_ARGMIN:
+        return "COL_ROL_ARGMIN";
+    case AssetObserverType::COL_ROL_ARGMAX:
+        return "COL_ROL_ARGMAX";
+    case AssetObserverType::COL_ROL_RANK:
+        return "COL_ROL_RANK";
+    case AssetObserverType::COL_ROL_MEDIAN:
+        return "COL_ROL_MEDIAN";
+    case AssetObserverType::COL_ROL_QUANTILE:
+        return "COL_ROL_QUANTILE";
+    case AssetObserverType::COL_ROL_OLS:
+        return "COL_ROL_OLS";
     default:
         return "Unknown"; // Return a default value for unknown enums
     }
@@ -45,258 +72,943 @@ std::string AssetObserverTypeToString(AssetObserverType type)
 
 
 //============================================================================
-std::expected<AssetPtr, AgisException>  get_enclosing_asset(
-    std::shared_ptr<Asset> a1,
-    std::shared_ptr<Asset> a2
-)
+void MeanVisitor::build() {
+    auto col = this->asset->__get_column(this->col_name);
+    this->result.clear();
+    this->result.resize(col.size());
+    Kernels::rolling_mean(col, this->r_count, this->result);
+}
+
+
+//============================================================================
+void VarVisitor::build() {
+    auto col = this->asset->__get_column(this->col_name);
+    this->result.clear();
+    this->result.resize(col.size());
+    Kernels::rolling_variance(col, this->r_count, this->result);
+}
+
+
+//============================================================================
+void RollingZScoreVisitor::build() {
+    auto col = this->asset->__get_column(this->col_name);
+    this->result.clear();
+    this->result.resize(col.size());
+    Kernels::rolling_zscore(col, this->r_count, this->result);
+}
+
+
+//============================================================================
+static size_t get_observer_col_index(Asset* asset, std::string const& col_name)
 {
-    auto res = a1->encloses(a2);
-    if (res.is_exception()) {
-        return  std::unexpected<AgisException>(res.get_exception());
+    auto& headers = asset->get_headers();
+    auto it = headers.find(col_name);
+    if (it == headers.end()) {
+        throw std::runtime_error("missing column: " + col_name);
     }
-    // a1 is the enclosing asset
-    if (res.unwrap()) {
-        return a1;
-    }
-    else {
-        res = a2->encloses(a1);
-        if (res.is_exception()) {
-            return  std::unexpected<AgisException>(res.get_exception());
-        }
-        // a2 is the enclosing asset
-        else if (res.unwrap()) {
-            return a2;
-        }
-        // no enclosing asset was fount
-        else {
-            auto msg = "Assets " + a1->get_asset_id() + " and " + a2->get_asset_id() + " do not enclose each other";
-            return  std::unexpected<AgisException>(AGIS_EXCEP(msg));
-        }
+    return it->second;
+}
+
+
+//============================================================================
+StreamingColObserver::StreamingColObserver(
+    Asset* asset_,
+    AssetObserverType type_,
+    std::string col_name_,
+    size_t r_count_
+) :
+    AssetObserver(asset_),
+    observer_type(type_),
+    col_name(std::move(col_name_)),
+    r_count(r_count_)
+{
+    if (!this->r_count) throw std::runtime_error("rolling window must be greater than 0");
+    this->col_index = get_observer_col_index(asset_, this->col_name);
+    this->buffer.resize(this->r_count);
+    this->set_warmup(this->r_count);
+}
+
+
+//============================================================================
+void StreamingColObserver::on_step()
+{
+    // the observer is stepped by the asset so the current row is always in range
+    this->push(this->asset->__get_column(this->col_index)[this->asset->get_current_index()]);
+}
+
+
+//============================================================================
+void StreamingColObserver::push(double x) noexcept
+{
+    // missing values are skipped so they never enter the running moments
+    this->last = x;
+    if (std::isnan(x)) return;
+
+    // once the window is full drop the value leaving the ring buffer
+    if (this->moments.n == this->r_count) {
+        double old = this->buffer[this->head];
+        this->moments.remove(old, old);
     }
+    this->buffer[this->head] = x;
+    this->head = (this->head + 1) % this->r_count;
+    this->moments.add(x, x);
 }
 
 
 //============================================================================
-IncrementalCovariance::IncrementalCovariance(
-    std::shared_ptr<Asset> a1,
-    std::shared_ptr<Asset> a2) : AssetObserver(a1.get())
+void StreamingColObserver::on_reset()
 {
+    std::fill(this->buffer.begin(), this->buffer.end(), 0.0);
+    this->head = 0;
+    this->last = 0;
+    this->moments.clear();
+#ifdef _DEBUG
+    this->verify_precompute();
+#endif
+}
+
+
 #ifdef _DEBUG
-    if (a1->get_frequency() != a2->get_frequency())
-    {
-        throw std::runtime_error("Assets must have the same frequency");
+//============================================================================
+void StreamingColObserver::verify_precompute() const
+{
+    // both modes share one key, so whichever observer is built first is handed to every caller. Replay
+    // the column through a copy and check it against the precomputed kernels up to the first missing
+    // value, past which the kernels carry NaN while the stream skips it.
+    auto col = this->asset->__get_column(this->col_index);
+    std::vector<double> expected(col.size());
+    switch (this->observer_type) {
+    case AssetObserverType::COL_ROL_MEAN:
+        Kernels::rolling_mean(col, this->r_count, expected);
+        break;
+    case AssetObserverType::COL_ROL_VAR:
+        Kernels::rolling_variance(col, this->r_count, expected);
+        break;
+    case AssetObserverType::COL_ROL_ZSCORE:
+        Kernels::rolling_zscore(col, this->r_count, expected);
+        break;
+    default:
+        return;
     }
-    if (a1->get_current_index() != a2->get_current_index())
-    {
-        throw std::runtime_error("Assets must have the same current index");
+
+    StreamingColObserver replay(*this);
+    for (size_t i = 0; i < col.size(); i++) {
+        if (std::isnan(col[i])) break;
+        replay.push(col[i]);
+        if (i + 1 < this->r_count) continue;
+
+        double a = replay.get_result();
+        double b = expected[i];
+        assert((std::isnan(a) && std::isnan(b)) || std::abs(a - b) <= 1e-8 * std::max(1.0, std::abs(b)));
     }
+}
 #endif
 
-    a1->__set_warmup(period * step_size);
-    a2->__set_warmup(period * step_size);
 
-    // find the enclosing asset. One aset most enclose the other i.e. the datetimeindex of the child 
-    // must be a subset of the enclosing asset and have no gaps
-    auto res = get_enclosing_asset(a1, a2);
-    if (!res.has_value()) {
-        throw res.error();
+//============================================================================
+double StreamingColObserver::get_result() const noexcept
+{
+    if (this->moments.n < this->r_count) return std::numeric_limits<double>::quiet_NaN();
+    switch (this->observer_type) {
+    case AssetObserverType::COL_ROL_MEAN:
+        return this->moments.mean_x;
+    case AssetObserverType::COL_ROL_VAR:
+        // the precomputed kernel clamps the rounding error of a flat window to zero
+        return std::max(this->moments.sample_covariance(), 0.0);
+    case AssetObserverType::COL_ROL_ZSCORE: {
+        double var = this->moments.sample_covariance();
+        if (std::isnan(var) || var <= 0.0) return std::numeric_limits<double>::quiet_NaN();
+        return (this->last - this->moments.mean_x) / std::sqrt(var);
     }
-    this->enclosing_asset = res.value();
-    if (this->enclosing_asset == a1) {
-        this->child_asset = a2;
+    default:
+        return std::numeric_limits<double>::quiet_NaN();
     }
-    else {
-        this->child_asset = a1;
+}
+
+
+//============================================================================
+std::string StreamingColObserver::str_rep() const noexcept
+{
+    return roll_col_observer_key(this->observer_type, this->col_name, this->r_count);
+}
+
+
+//============================================================================
+StreamingCovObserver::StreamingCovObserver(
+    Asset* asset_,
+    std::string col_a_,
+    std::string col_b_,
+    size_t r_count_
+) :
+    AssetObserver(asset_),
+    col_a(std::move(col_a_)),
+    col_b(std::move(col_b_)),
+    r_count(r_count_)
+{
+    if (!this->r_count) throw std::runtime_error("rolling window must be greater than 0");
+    this->col_a_index = get_observer_col_index(asset_, this->col_a);
+    this->col_b_index = get_observer_col_index(asset_, this->col_b);
+    this->buffer.resize(this->r_count);
+    this->set_warmup(this->r_count);
+}
+
+
+//============================================================================
+void StreamingCovObserver::on_step()
+{
+    auto row = this->asset->get_current_index();
+    double x = this->asset->__get_column(this->col_a_index)[row];
+    double y = this->asset->__get_column(this->col_b_index)[row];
+    // a pair with either side missing is skipped
+    if (std::isnan(x) || std::isnan(y)) return;
+
+    if (this->moments.n == this->r_count) {
+        auto& [old_x, old_y] = this->buffer[this->head];
+        this->moments.remove(old_x, old_y);
     }
+    this->buffer[this->head] = { x, y };
+    this->head = (this->head + 1) % this->r_count;
+    this->moments.add(x, y);
+}
+
 
-    // add this to the encosing asset observer list. The enclosing asset must be used as the index into 
-    // the enclosing span assumes alignment with the closing span.
-    this->enclosing_asset->add_observer(this);
-    this->set_asset_ptr(this->enclosing_asset.get());
-    this->enclosing_span = enclosing_asset->get_volatility_column();
-    this->child_span = child_asset->get_volatility_column();
-    this->enclosing_span_start_index = enclosing_asset->encloses_index(child_asset).unwrap();
+//============================================================================
+void StreamingCovObserver::on_reset()
+{
+    std::fill(this->buffer.begin(), this->buffer.end(), std::make_pair(0.0, 0.0));
+    this->head = 0;
+    this->moments.clear();
 }
 
 
 //============================================================================
-void IncrementalCovariance::on_step()
+std::string StreamingCovObserver::str_rep() const noexcept
 {
-    // if the current index is less than the enclosing span start index then return, not in the time period in which
-    // the two assets have overlapping data
-    if (this->index <= this->enclosing_span_start_index || this->index < step_size) {
-        this->index++;
+    return roll_cov_observer_key(this->col_a, this->col_b, this->r_count);
+}
+
+
+//============================================================================
+EWMAObserver::EWMAObserver(
+    Asset* asset_,
+    AssetObserverType type_,
+    std::string col_name_,
+    size_t half_life_
+) :
+    AssetObserver(asset_),
+    observer_type(type_),
+    col_name(std::move(col_name_)),
+    half_life(half_life_)
+{
+    if (!this->half_life) throw std::runtime_error("half life must be greater than 0");
+    this->col_index = get_observer_col_index(asset_, this->col_name);
+    this->alpha = 1.0 - std::pow(0.5, 1.0 / static_cast<double>(this->half_life));
+    this->set_warmup(this->half_life);
+}
+
+
+//============================================================================
+void EWMAObserver::on_step()
+{
+    auto res = this->asset->get_asset_feature(this->col_index, 0);
+    if (!res.has_value() || std::isnan(res.value())) return;
+    double x = res.value();
+    if (!this->count) {
+        this->mean = x;
+        this->var = 0;
+        this->count++;
         return;
     }
+    double delta = x - this->mean;
+    this->mean += this->alpha * delta;
+    this->var = (1.0 - this->alpha) * (this->var + this->alpha * delta * delta);
+    this->count++;
+}
 
-    // check if on step
-    if (this->index % step_size != 0) {
-        this->index++;
-        return;
+
+//============================================================================
+void EWMAObserver::on_reset()
+{
+    this->count = 0;
+    this->mean = 0;
+    this->var = 0;
+}
+
+
+//============================================================================
+double EWMAObserver::get_result() const noexcept
+{
+    if (this->count < this->half_life) return std::numeric_limits<double>::quiet_NaN();
+    if (this->observer_type == AssetObserverType::COL_EWMA_VAR) return this->var;
+    return this->mean;
+}
+
+
+//============================================================================
+std::string EWMAObserver::str_rep() const noexcept
+{
+    return roll_col_observer_key(this->observer_type, this->col_name, this->half_life);
+}
+
+
+//============================================================================
+RollingExtremaObserver::RollingExtremaObserver(
+    Asset* asset_,
+    AssetObserverType type_,
+    std::string col_name_,
+    size_t r_count_
+) :
+    AssetObserver(asset_),
+    observer_type(type_),
+    col_name(std::move(col_name_)),
+    r_count(r_count_)
+{
+    if (!this->r_count) throw std::runtime_error("rolling window must be greater than 0");
+    this->is_max = type_ == AssetObserverType::COL_ROL_MAX || type_ == AssetObserverType::COL_ROL_ARGMAX;
+    this->col_index = get_observer_col_index(asset_, this->col_name);
+    this->set_warmup(this->r_count);
+}
+
+
+//============================================================================
+void RollingExtremaObserver::on_step()
+{
+    size_t step = this->step_count++;
+
+    // expire the candidate that has left the window
+    if (!this->candidates.empty() && this->candidates.front().first + this->r_count <= step) {
+        this->candidates.pop_front();
     }
 
-    auto child_index = index - this->enclosing_span_start_index;
-    double enclose_pct_change = (enclosing_span[index] - enclosing_span[index - step_size]) / enclosing_span[index - step_size];
-    double child_pct_change = (child_span[child_index] - child_span[child_index - step_size]) / child_span[child_index - step_size];
-    this->sum1 += enclose_pct_change;
-    this->sum2 += child_pct_change;
-    this->sum_product += enclose_pct_change * child_pct_change;
-    this->sum1_squared += enclose_pct_change * enclose_pct_change;
-    this->sum2_squared += child_pct_change * child_pct_change;
+    auto res = this->asset->get_asset_feature(this->col_index, 0);
+    if (!res.has_value() || std::isnan(res.value())) return;
+    double x = res.value();
 
-    // check if in warmup
-    if (child_index < this->period * this->step_size) {
-        this->index++;
-        return;
+    // drop candidates that can never be the extreme again while x is in the window
+    if (this->is_max) {
+        while (!this->candidates.empty() && this->candidates.back().second <= x) this->candidates.pop_back();
     }
+    else {
+        while (!this->candidates.empty() && this->candidates.back().second >= x) this->candidates.pop_back();
+    }
+    this->candidates.emplace_back(step, x);
+}
+
+
+//============================================================================
+void RollingExtremaObserver::on_reset()
+{
+    this->step_count = 0;
+    this->candidates.clear();
+}
+
 
-    // check if need to remove the previous value
-    if (child_index > this->period) {
-        size_t child_index_prev = (child_index - 1) - (this->period * this->step_size - this->step_size);
-        size_t index_prev = (index - 1) - (this->period * this->step_size - this->step_size);
-        enclose_pct_change = (enclosing_span[index_prev] - enclosing_span[index_prev - step_size]) / enclosing_span[index_prev - step_size];
-        child_pct_change = (child_span[child_index_prev] - child_span[child_index_prev - step_size]) / child_span[child_index_prev - step_size];
-        this->sum1 -= enclose_pct_change;
-        this->sum2 -= child_pct_change;
-        this->sum_product -= enclose_pct_change * child_pct_change;
-        this->sum1_squared -= enclose_pct_change * enclose_pct_change;
-        this->sum2_squared -= child_pct_change * child_pct_change;
+//============================================================================
+double RollingExtremaObserver::get_result() const noexcept
+{
+    if (this->step_count < this->r_count || this->candidates.empty()) return std::numeric_limits<double>::quiet_NaN();
+    auto const& [step, value] = this->candidates.front();
+    switch (this->observer_type) {
+    case AssetObserverType::COL_ROL_ARGMIN:
+    case AssetObserverType::COL_ROL_ARGMAX:
+        return static_cast<double>(this->step_count - 1 - step);
+    default:
+        return value;
     }
+}
 
-    // set covariance and matrix pointers
-    this->covariance = (sum_product - sum1 * sum2 / period) / (period - 1);
-    *this->upper_triangular = this->covariance;
-    *this->lower_triangular = this->covariance;
 
-    this->index++;
+//============================================================================
+std::string RollingExtremaObserver::str_rep() const noexcept
+{
+    return roll_col_observer_key(this->observer_type, this->col_name, this->r_count);
 }
 
 
 //============================================================================
-void IncrementalCovariance::on_reset()
+OrderStatisticTree::OrderStatisticTree(size_t capacity)
 {
-    this->sum1 = 0.0;
-    this->sum2 = 0.0;
-    this->sum_product = 0.0;
-    this->sum1_squared = 0.0;
-    this->sum2_squared = 0.0;
-    this->covariance = 0.0;
-    this->index = 0;
-    *this->lower_triangular = 0.0f;
-    *this->upper_triangular = 0.0f;
+    this->nodes.resize(capacity);
+    this->clear();
+}
+
+
+//============================================================================
+void OrderStatisticTree::clear() noexcept
+{
+    this->root = null_node;
+    this->free_nodes.resize(this->nodes.size());
+    for (size_t i = 0; i < this->nodes.size(); i++) {
+        this->free_nodes[i] = this->nodes.size() - 1 - i;
+    }
 }
 
 
 //============================================================================
-std::string IncrementalCovariance::str_rep() const noexcept
+void OrderStatisticTree::update(size_t n) noexcept
 {
+    auto& node = this->nodes[n];
+    node.size = 1 + this->node_size(node.left) + this->node_size(node.right);
+}
+
+
+//============================================================================
+void OrderStatisticTree::split(size_t n, double value, size_t& lo, size_t& hi) noexcept
+{
+    // lo holds the values < value, hi the values >= value
+    if (n == null_node) {
+        lo = hi = null_node;
+        return;
+    }
+    auto& node = this->nodes[n];
+    if (node.value < value) {
+        this->split(node.right, value, node.right, hi);
+        lo = n;
+    }
+    else {
+        this->split(node.left, value, lo, node.left);
+        hi = n;
+    }
+    this->update(n);
+}
 
-    return this->child_asset->get_asset_id() + "_INC_COV_" + std::to_string(this->period);
 
+//============================================================================
+void OrderStatisticTree::split_first(size_t n, size_t& first, size_t& rest) noexcept
+{
+    // detach the smallest node of a non empty tree
+    auto& node = this->nodes[n];
+    if (node.left == null_node) {
+        first = n;
+        rest = node.right;
+        node.right = null_node;
+    }
+    else {
+        this->split_first(node.left, first, node.left);
+        rest = n;
+    }
+    this->update(n);
 }
 
 
 //============================================================================
-void IncrementalCovariance::set_pointers(double* upper_triangular_, double* lower_triangular_)
+size_t OrderStatisticTree::merge(size_t a, size_t b) noexcept
 {
-    this->upper_triangular = upper_triangular_;
-    this->lower_triangular = lower_triangular_;
+    // every value of a is <= every value of b
+    if (a == null_node) return b;
+    if (b == null_node) return a;
+    if (this->nodes[a].priority > this->nodes[b].priority) {
+        this->nodes[a].right = this->merge(this->nodes[a].right, b);
+        this->update(a);
+        return a;
+    }
+    this->nodes[b].left = this->merge(a, this->nodes[b].left);
+    this->update(b);
+    return b;
 }
 
 
+//============================================================================
+void OrderStatisticTree::insert(double value) noexcept
+{
+    // xorshift priorities, deterministic so runs are reproducible
+    this->seed ^= this->seed << 13;
+    this->seed ^= this->seed >> 17;
+    this->seed ^= this->seed << 5;
+
+    size_t n = this->free_nodes.back();
+    this->free_nodes.pop_back();
+    this->nodes[n] = Node{ value, this->seed, null_node, null_node, 1 };
+
+    size_t lo, hi;
+    this->split(this->root, value, lo, hi);
+    this->root = this->merge(this->merge(lo, n), hi);
+}
+
 
 //============================================================================
-void MeanVisitor::build() {
-    auto col = this->asset->__get_column(this->col_name);
-    this->result.clear();
-    this->result.resize(col.size());
-    double sum = 0;
-    for (size_t i = 0; i < col.size(); i++) {
-        if (i >= r_count) {
-            sum -= col[i - r_count];
+void OrderStatisticTree::erase(double value) noexcept
+{
+    size_t lo, hi;
+    this->split(this->root, value, lo, hi);
+    if (hi != null_node) {
+        size_t first, rest;
+        this->split_first(hi, first, rest);
+        if (this->nodes[first].value == value) {
+            this->free_nodes.push_back(first);
+            hi = rest;
+        }
+        else {
+            hi = this->merge(first, rest);
         }
-        sum += col[i];
+    }
+    this->root = this->merge(lo, hi);
+}
+
 
-        if (i >= r_count - 1) {
-            this->result[i] = sum / r_count;
+//============================================================================
+size_t OrderStatisticTree::count_less_equal(double value) const noexcept
+{
+    size_t count = 0;
+    size_t n = this->root;
+    while (n != null_node) {
+        auto const& node = this->nodes[n];
+        if (node.value <= value) {
+            count += this->node_size(node.left) + 1;
+            n = node.right;
         }
         else {
-            this->result[i] = std::numeric_limits<double>::quiet_NaN();
+            n = node.left;
         }
     }
+    return count;
 }
 
 
 //============================================================================
-void VarVisitor::build() {
-    auto col = this->asset->__get_column(this->col_name);
-    this->result.clear();
-    this->result.resize(col.size());
-    double sum = 0;
-    double sos = 0;
-
-    for (size_t i = 0; i < col.size(); i++) {
-        if (i >= r_count) {
-            sum -= col[i - r_count];
-            sos -= col[i - r_count] * col[i - r_count];
+double OrderStatisticTree::select(size_t k) const noexcept
+{
+    size_t n = this->root;
+    while (n != null_node) {
+        auto const& node = this->nodes[n];
+        auto left = this->node_size(node.left);
+        if (k < left) {
+            n = node.left;
         }
-        sum += col[i];
-        sos += col[i] * col[i];
-
-        if (i >= r_count - 1) {
-            double mean = sum / r_count;
-            double variance = (sos / (r_count - 1)) - (mean * mean);
-            this->result[i] = variance;
+        else if (k == left) {
+            return node.value;
         }
         else {
-            // Push NaN during the warm-up period
-            this->result[i] = std::numeric_limits<double>::quiet_NaN();
+            k -= left + 1;
+            n = node.right;
         }
     }
+    return std::numeric_limits<double>::quiet_NaN();
 }
 
 
+//============================================================================
+RollingRankObserver::RollingRankObserver(
+    Asset* asset_,
+    AssetObserverType type_,
+    std::string col_name_,
+    size_t r_count_,
+    double quantile_
+) :
+    AssetObserver(asset_),
+    observer_type(type_),
+    col_name(std::move(col_name_)),
+    r_count(r_count_),
+    quantile(quantile_),
+    tree(r_count_)
+{
+    if (!this->r_count) throw std::runtime_error("rolling window must be greater than 0");
+    if (!(this->quantile >= 0.0 && this->quantile <= 1.0)) throw std::runtime_error("quantile must be in [0, 1]");
+    if (type_ == AssetObserverType::COL_ROL_MEDIAN) this->quantile = 0.5;
+    this->col_index = get_observer_col_index(asset_, this->col_name);
+    this->buffer.resize(this->r_count, std::numeric_limits<double>::quiet_NaN());
+    this->set_warmup(this->r_count);
+}
+
 
 //============================================================================
-void RollingZScoreVisitor::build() {
-    mean_visitor.build();
-    var_visitor.build();
+void RollingRankObserver::on_step()
+{
+    this->step_count++;
 
-    const std::vector<double>& mean = mean_visitor.get_result_vec();
-    const std::vector<double>& variance = var_visitor.get_result_vec();
-    auto col = this->asset->__get_column(this->col_name);
-    this->result.clear();
-    this->result.resize(mean.size());
+    double old = this->buffer[this->head];
+    if (!std::isnan(old)) this->tree.erase(old);
+
+    double x = this->asset->__get_column(this->col_index)[this->asset->get_current_index()];
+    if (!std::isnan(x)) this->tree.insert(x);
+    this->buffer[this->head] = x;
+    this->current = x;
+    this->head = (this->head + 1) % this->r_count;
+}
+
+
+//============================================================================
+void RollingRankObserver::on_reset()
+{
+    std::fill(this->buffer.begin(), this->buffer.end(), std::numeric_limits<double>::quiet_NaN());
+    this->tree.clear();
+    this->head = 0;
+    this->step_count = 0;
+    this->current = std::numeric_limits<double>::quiet_NaN();
+}
+
+
+//============================================================================
+double RollingRankObserver::get_result() const noexcept
+{
+    constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+    auto count = this->tree.size();
+    if (this->step_count < this->r_count || !count) return nan;
+    if (this->observer_type == AssetObserverType::COL_ROL_RANK) {
+        if (std::isnan(this->current)) return nan;
+        return static_cast<double>(this->tree.count_less_equal(this->current)) / static_cast<double>(count);
+    }
+
+    // linear interpolation between the order statistics either side of the quantile
+    double pos = this->quantile * static_cast<double>(count - 1);
+    size_t lo = static_cast<size_t>(std::floor(pos));
+    size_t hi = static_cast<size_t>(std::ceil(pos));
+    double lo_value = this->tree.select(lo);
+    if (hi == lo) return lo_value;
+    double hi_value = this->tree.select(hi);
+    return lo_value + (hi_value - lo_value) * (pos - static_cast<double>(lo));
+}
+
+
+//============================================================================
+std::string RollingRankObserver::str_rep() const noexcept
+{
+    if (this->observer_type == AssetObserverType::COL_ROL_QUANTILE) {
+        return roll_quantile_observer_key(this->col_name, this->r_count, this->quantile);
+    }
+    return roll_col_observer_key(this->observer_type, this->col_name, this->r_count);
+}
+
+
+//============================================================================
+RollingOLSObserver::RollingOLSObserver(
+    Asset* asset_,
+    std::string y_col_,
+    std::vector<OLSRegressor> regressors_,
+    size_t r_count_
+) :
+    AssetObserver(asset_),
+    y_col(std::move(y_col_)),
+    regressors(std::move(regressors_)),
+    r_count(r_count_)
+{
+    this->k = this->regressors.size();
+    if (!this->k) throw std::runtime_error("ols observer requires at least one regressor");
+    if (this->r_count <= this->k + 1) throw std::runtime_error("rolling window must be greater than the number of coefficients");
+
+    this->y_index = get_observer_col_index(asset_, this->y_col);
+    for (auto& regressor : this->regressors) {
+        if (!regressor.asset) regressor.asset = asset_;
+        this->regressor_index.push_back(get_observer_col_index(regressor.asset, regressor.col));
+    }
+
+    size_t m = this->k + 1;
+    this->shift.resize(m + 1);
+    this->buffer.resize(this->r_count * (m + 1));
+    this->row_valid.resize(this->r_count);
+    this->xtx.resize(m * m);
+    this->xty.resize(m);
+    this->coef.resize(m, std::numeric_limits<double>::quiet_NaN());
+    this->normal_matrix.resize(m, m);
+    this->normal_rhs.resize(m);
+    this->solution.resize(m);
+    this->ldlt = Eigen::LDLT<Eigen::MatrixXd>(m);
+    this->bind_regressors();
+    this->set_warmup(this->r_count);
+}
+
+
+//============================================================================
+void RollingOLSObserver::bind_regressors() noexcept
+{
+    this->regressor_columns.clear();
+    this->regressor_dt_index.clear();
+    for (size_t i = 0; i < this->k; i++) {
+        auto const* regressor_asset = this->regressors[i].asset;
+        this->regressor_columns.push_back(regressor_asset->__get_column(this->regressor_index[i]));
+        this->regressor_dt_index.push_back(regressor_asset->__get_dt_index(false));
+    }
+    this->regressor_cursor.assign(this->k, 0);
+}
+
+
+//============================================================================
+double RollingOLSObserver::read_regressor(size_t i, long long t) noexcept
+{
+    auto const& dt_index = this->regressor_dt_index[i];
+    auto& cursor = this->regressor_cursor[i];
+    while (cursor < dt_index.size() && dt_index[cursor] < t) cursor++;
+    if (cursor == dt_index.size() || dt_index[cursor] != t) return std::numeric_limits<double>::quiet_NaN();
+    return this->regressor_columns[i][cursor];
+}
 
-    for (size_t i = 0; i < mean.size(); i++) {
-        if (!std::isnan(mean[i]) && !std::isnan(variance[i]) && variance[i] > 0) {
-            this->result[i] = (col[i] - mean[i]) / std::sqrt(variance[i]);
+
+//============================================================================
+void RollingOLSObserver::update_row(double const* row, double sign) noexcept
+{
+    // row is [1, x_1 .. x_k, y], only the upper triangle of X'X is kept
+    size_t m = this->k + 1;
+    double y = row[m];
+    for (size_t i = 0; i < m; i++) {
+        double xi = sign * row[i];
+        this->xty[i] += xi * y;
+        for (size_t j = i; j < m; j++) {
+            this->xtx[i * m + j] += xi * row[j];
         }
-        else {
-            // Push NaN for undefined Z-score values
-            this->result[i] = std::numeric_limits<double>::quiet_NaN();
+    }
+    this->yty += sign * y * y;
+    this->y_sum += sign * y;
+}
+
+
+//============================================================================
+void RollingOLSObserver::solve() noexcept
+{
+    constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+    size_t m = this->k + 1;
+    std::fill(this->coef.begin(), this->coef.end(), nan);
+    this->r2 = nan;
+    if (this->n <= m) return;
+
+    auto& a = this->normal_matrix;
+    auto& b = this->normal_rhs;
+    auto& x = this->solution;
+    for (size_t i = 0; i < m; i++) {
+        b(i) = this->xty[i];
+        for (size_t j = i; j < m; j++) {
+            a(i, j) = this->xtx[i * m + j];
+            a(j, i) = this->xtx[i * m + j];
         }
     }
+    this->ldlt.compute(a);
+    if (this->ldlt.info() != Eigen::Success || !this->ldlt.isPositive()) return;
+    x = this->ldlt.solve(b);
+    for (size_t i = 0; i < m; i++) this->coef[i] = x(i);
+
+    double n_d = static_cast<double>(this->n);
+    double sst = this->yty - this->y_sum * this->y_sum / n_d;
+    double ssr = this->yty - x.dot(b);
+    if (sst > 0.0) this->r2 = 1.0 - std::max(ssr, 0.0) / sst;
 }
 
+
 //============================================================================
-std::expected<AssetObserverPtr, AgisException> create_inc_cov_observer(
-    std::shared_ptr<Asset> a1,
-    std::shared_ptr<Asset> a2
-) {
-    std::shared_ptr<AssetObserver> ptr = nullptr;
-    try {
-        ptr = std::make_shared<IncrementalCovariance>(
-            a1,
-            a2
-        );
+void RollingOLSObserver::on_step()
+{
+    size_t m = this->k + 1;
+    size_t stride = m + 1;
+    this->step_count++;
+
+    double* row = this->buffer.data() + this->head * stride;
+    if (this->row_valid[this->head]) {
+        this->update_row(row, -1.0);
+        this->n--;
     }
-    catch (std::exception& e) {
-		return std::unexpected<AgisException>(AGIS_EXCEP(e.what()));
-	}
 
-    if (!ptr) return std::unexpected<AgisException>(AGIS_EXCEP("Failed to create observer"));
-    return ptr;
+    // read the current row, regressors are aligned by datetime so a reference asset that has
+    // not stepped yet, or has no bar at this time, is handled the same whatever the step order
+    row[0] = 1.0;
+    bool valid = true;
+    auto y = this->asset->get_asset_feature(this->y_index, 0);
+    valid &= y.has_value() && !std::isnan(y.value());
+    auto t = this->asset->__get_dt_index(false)[this->asset->get_current_index()];
+    for (size_t i = 0; valid && i < this->k; i++) {
+        double x = this->read_regressor(i, t);
+        valid &= !std::isnan(x);
+        if (valid) row[i + 1] = x;
+    }
+    if (valid) row[m] = y.value();
+
+    if (valid && !this->shift_set) {
+        std::copy(row + 1, row + stride, this->shift.begin() + 1);
+        this->shift_set = true;
+    }
+    this->row_valid[this->head] = valid;
+    this->residual = std::numeric_limits<double>::quiet_NaN();
+    if (valid) {
+        for (size_t i = 1; i < stride; i++) row[i] -= this->shift[i];
+        this->update_row(row, 1.0);
+        this->n++;
+    }
+    this->head = (this->head + 1) % this->r_count;
+
+    if (this->step_count < this->r_count) return;
+    this->solve();
+    if (valid && !std::isnan(this->coef[0])) {
+        double fitted = this->coef[0];
+        for (size_t i = 1; i < m; i++) fitted += this->coef[i] * row[i];
+        this->residual = row[m] - fitted;
+    }
+}
+
+
+//============================================================================
+void RollingOLSObserver::on_reset()
+{
+    constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+    std::fill(this->buffer.begin(), this->buffer.end(), 0.0);
+    std::fill(this->row_valid.begin(), this->row_valid.end(), 0);
+    std::fill(this->xtx.begin(), this->xtx.end(), 0.0);
+    std::fill(this->xty.begin(), this->xty.end(), 0.0);
+    std::fill(this->shift.begin(), this->shift.end(), 0.0);
+    std::fill(this->coef.begin(), this->coef.end(), nan);
+    this->shift_set = false;
+    this->bind_regressors();
+    this->head = 0;
+    this->step_count = 0;
+    this->n = 0;
+    this->yty = 0;
+    this->y_sum = 0;
+    this->r2 = nan;
+    this->residual = nan;
+}
+
+
+//============================================================================
+double RollingOLSObserver::get_alpha() const noexcept
+{
+    // undo the shift of the inputs, the slopes are unaffected
+    double alpha = this->coef[0] + this->shift[this->k + 1];
+    for (size_t i = 0; i < this->k; i++) {
+        alpha -= this->coef[i + 1] * this->shift[i + 1];
+    }
+    return alpha;
+}
+
+
+//============================================================================
+double RollingOLSObserver::get_beta(size_t i) const noexcept
+{
+    if (i >= this->k) return std::numeric_limits<double>::quiet_NaN();
+    return this->coef[i + 1];
+}
+
+
+//============================================================================
+double RollingOLSObserver::get_result() const noexcept
+{
+    return this->get_beta(0);
+}
+
+
+//============================================================================
+std::string RollingOLSObserver::str_rep() const noexcept
+{
+    return roll_ols_observer_key(this->asset.get(), this->y_col, this->regressors, this->r_count);
+}
+
+
+//============================================================================
+RollingOLSOutputObserver::RollingOLSOutputObserver(
+    Asset* asset_,
+    RollingOLSObserver const* regression_,
+    OLSOutput output_,
+    size_t beta_index_
+) :
+    AssetObserver(asset_),
+    regression(regression_),
+    output(output_),
+    beta_index(beta_index_)
+{
+    if (this->output == OLSOutput::BETA && this->beta_index >= this->regression->get_regressor_count()) {
+        throw std::runtime_error("beta index out of range");
+    }
+    this->set_warmup(this->regression->get_warmup());
+}
+
+
+//============================================================================
+double RollingOLSOutputObserver::get_result() const noexcept
+{
+    switch (this->output) {
+    case OLSOutput::ALPHA:
+        return this->regression->get_alpha();
+    case OLSOutput::BETA:
+        return this->regression->get_beta(this->beta_index);
+    case OLSOutput::R2:
+        return this->regression->get_r2();
+    case OLSOutput::RESIDUAL:
+        return this->regression->get_residual();
+    default:
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+
+//============================================================================
+static std::string ols_output_suffix(OLSOutput output_, size_t beta_index_)
+{
+    switch (output_) {
+    case OLSOutput::ALPHA:
+        return "_ALPHA";
+    case OLSOutput::BETA:
+        return "_BETA_" + std::to_string(beta_index_);
+    case OLSOutput::R2:
+        return "_R2";
+    default:
+        return "_RESIDUAL";
+    }
+}
+
+
+//============================================================================
+std::string RollingOLSOutputObserver::str_rep() const noexcept
+{
+    return this->regression->str_rep() + ols_output_suffix(this->output, this->beta_index);
+}
+
+
+//============================================================================
+std::string roll_col_observer_key(
+    AssetObserverType type_,
+    std::string const& col_name_,
+    size_t r_count_)
+{
+    // the evaluation mode does not change the result so observers are shared across modes
+    auto rep = col_name_ + "_" + AssetObserverTypeToString(type_) + "_" + std::to_string(r_count_);
+    if (type_ == AssetObserverType::COL_ROL_ZSCORE) rep += "_ZScore";
+    return rep;
+}
+
+
+//============================================================================
+std::string roll_quantile_observer_key(
+    std::string const& col_name_,
+    size_t r_count_,
+    double quantile_)
+{
+    return col_name_ + "_" + AssetObserverTypeToString(AssetObserverType::COL_ROL_QUANTILE) + "_"
+        + std::to_string(r_count_) + "_" + std::format("{}", quantile_);
+}
+
+
+//============================================================================
+std::string roll_ols_observer_key(
+    Asset const* asset_,
+    std::string const& y_col_,
+    std::vector<OLSRegressor> const& regressors_,
+    size_t r_count_)
+{
+    auto rep = y_col_;
+    for (auto const& regressor : regressors_) {
+        // regressors without an asset use the observed asset's own column
+        auto const* regressor_asset = regressor.asset ? regressor.asset : asset_;
+        rep += "_" + regressor_asset->get_asset_id() + ":" + regressor.col;
+    }
+    return rep + "_" + AssetObserverTypeToString(AssetObserverType::COL_ROL_OLS) + "_" + std::to_string(r_count_);
+}
+
+
+//============================================================================
+std::string roll_ols_output_key(
+    Asset const* asset_,
+    std::string const& y_col_,
+    std::vector<OLSRegressor> const& regressors_,
+    size_t r_count_,
+    OLSOutput output_,
+    size_t beta_index_)
+{
+    return roll_ols_observer_key(asset_, y_col_, regressors_, r_count_) + ols_output_suffix(output_, beta_index_);
+}
+
+
+//============================================================================
+std::string roll_cov_observer_key(
+    std::string const& col_a_,
+    std::string const& col_b_,
+    size_t r_count_)
+{
+    return col_a_ + "_" + col_b_ + "_" + AssetObserverTypeToString(AssetObserverType::COL_ROL_COV) + "_" + std::to_string(r_count_);
 }
 
 
@@ -305,22 +1017,194 @@ std::expected<AssetObserverPtr, AgisException> create_roll_col_observer(
     Asset* asset_,
     AssetObserverType type_,
     std::string col_name_,
-    size_t r_count_
+    size_t r_count_,
+    AssetObserverMode mode_
 )
 {
     std::shared_ptr<AssetObserver> ptr = nullptr;
     try {
-        switch (type_) {
-        case AssetObserverType::COL_ROL_MEAN:
-            ptr = std::make_shared<MeanVisitor>(
+        // exponentially weighted and extrema observers always stream so they ignore the mode
+        if (type_ == AssetObserverType::COL_EWMA_MEAN || type_ == AssetObserverType::COL_EWMA_VAR) {
+            ptr = std::make_shared<EWMAObserver>(
+                asset_,
+                type_,
+                col_name_,
+                r_count_
+            );
+        }
+        else if (
+            type_ == AssetObserverType::COL_ROL_MIN ||
+            type_ == AssetObserverType::COL_ROL_MAX ||
+            type_ == AssetObserverType::COL_ROL_ARGMIN ||
+            type_ == AssetObserverType::COL_ROL_ARGMAX) {
+            ptr = std::make_shared<RollingExtremaObserver>(
                 asset_,
+                type_,
                 col_name_,
                 r_count_
             );
-            break;
-        default:
-            break;
         }
+        else if (
+            type_ == AssetObserverType::COL_ROL_RANK ||
+            type_ == AssetObserverType::COL_ROL_MEDIAN) {
+            ptr = std::make_shared<RollingRankObserver>(
+                asset_,
+                type_,
+                col_name_,
+                r_count_
+            );
+        }
+        else if (mode_ == AssetObserverMode::STREAMING) {
+            switch (type_) {
+            case AssetObserverType::COL_ROL_MEAN:
+            case AssetObserverType::COL_ROL_VAR:
+            case AssetObserverType::COL_ROL_ZSCORE:
+                ptr = std::make_shared<StreamingColObserver>(
+                    asset_,
+                    type_,
+                    col_name_,
+                    r_count_
+                );
+                break;
+            default:
+                break;
+            }
+        }
+        else {
+            switch (type_) {
+            case AssetObserverType::COL_ROL_MEAN:
+                ptr = std::make_shared<MeanVisitor>(
+                    asset_,
+                    col_name_,
+                    r_count_
+                );
+                break;
+            case AssetObserverType::COL_ROL_VAR:
+                ptr = std::make_shared<VarVisitor>(
+                    asset_,
+                    col_name_,
+                    r_count_
+                );
+                break;
+            case AssetObserverType::COL_ROL_ZSCORE:
+                ptr = std::make_shared<RollingZScoreVisitor>(
+                    asset_,
+                    col_name_,
+                    r_count_
+                );
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    catch (std::exception& e) {
+        return std::unexpected<AgisException>(AGIS_EXCEP(e.what()));
+    }
+    if (!ptr) return std::unexpected<AgisException>(AGIS_EXCEP("Failed to create observer"));
+    return ptr;
+}
+
+
+//============================================================================
+std::expected<AssetObserverPtr, AgisException> create_roll_quantile_observer(
+    Asset* asset_,
+    std::string col_name_,
+    size_t r_count_,
+    double quantile_
+)
+{
+    std::shared_ptr<AssetObserver> ptr = nullptr;
+    try {
+        ptr = std::make_shared<RollingRankObserver>(
+            asset_,
+            AssetObserverType::COL_ROL_QUANTILE,
+            col_name_,
+            r_count_,
+            quantile_
+        );
+    }
+    catch (std::exception& e) {
+        return std::unexpected<AgisException>(AGIS_EXCEP(e.what()));
+    }
+    return ptr;
+}
+
+
+//============================================================================
+std::expected<AssetObserverPtr, AgisException> create_roll_ols_observer(
+    Asset* asset_,
+    std::string y_col_,
+    std::vector<OLSRegressor> regressors_,
+    size_t r_count_
+)
+{
+    std::shared_ptr<AssetObserver> ptr = nullptr;
+    try {
+        ptr = std::make_shared<RollingOLSObserver>(
+            asset_,
+            std::move(y_col_),
+            std::move(regressors_),
+            r_count_
+        );
+    }
+    catch (std::exception& e) {
+        return std::unexpected<AgisException>(AGIS_EXCEP(e.what()));
+    }
+    return ptr;
+}
+
+
+//============================================================================
+std::expected<AssetObserverPtr, AgisException> create_roll_ols_output_observer(
+    Asset* asset_,
+    std::string y_col_,
+    std::vector<OLSRegressor> regressors_,
+    size_t r_count_,
+    OLSOutput output_,
+    size_t beta_index_
+)
+{
+    auto key = roll_ols_observer_key(asset_, y_col_, regressors_, r_count_);
+    auto existing = asset_->get_observer(key);
+    if (existing.is_exception()) {
+        return std::unexpected<AgisException>(AGIS_EXCEP("missing regression observer: " + key));
+    }
+    auto regression = dynamic_cast<RollingOLSObserver const*>(existing.unwrap());
+    if (!regression) return std::unexpected<AgisException>(AGIS_EXCEP("not a regression observer: " + key));
+
+    std::shared_ptr<AssetObserver> ptr = nullptr;
+    try {
+        ptr = std::make_shared<RollingOLSOutputObserver>(
+            asset_,
+            regression,
+            output_,
+            beta_index_
+        );
+    }
+    catch (std::exception& e) {
+        return std::unexpected<AgisException>(AGIS_EXCEP(e.what()));
+    }
+    return ptr;
+}
+
+
+//============================================================================
+std::expected<AssetObserverPtr, AgisException> create_roll_cov_observer(
+    Asset* asset_,
+    std::string col_a_,
+    std::string col_b_,
+    size_t r_count_
+)
+{
+    std::shared_ptr<AssetObserver> ptr = nullptr;
+    try {
+        ptr = std::make_shared<StreamingCovObserver>(
+            asset_,
+            col_a_,
+            col_b_,
+            r_count_
+        );
     }
     catch (std::exception& e) {
         return std::unexpected<AgisException>(AGIS_EXCEP(e.what()));
@@ -1,14 +1,20 @@
 #include "pch.h" 
 #include <execution>
 #include <tbb/parallel_for_each.h>
+#include <tbb/parallel_for.h>
 #include <chrono>
+#include <format>
+#include <numeric>
+#include <algorithm>
 #include <Windows.h>
 #include <H5Cpp.h>
 
 #include "utils_array.h"
 #include "Exchange.h"
+#include "ExchangeMap.h"
 #include "AgisRouter.h"
 #include "AgisRisk.h"
+#include "AgisKernels.h"
 
 #include "Asset/Asset.h"
 #include "Time/TradingCalendar.h"
@@ -21,6 +27,36 @@ using namespace rapidjson;
 
 
 std::atomic<size_t> Exchange::exchange_counter(0);
+
+
+//============================================================================
+/**
+ * @brief move the first n elements under comp to the front of the range in order. Selects with
+ * nth_element and only sorts the selected slice, O(size + n log n).
+*/
+template <typename It, typename Compare>
+static void select_front(It begin, It end, size_t n, Compare comp)
+{
+	if (n == 0) return;
+	if (static_cast<size_t>(end - begin) > n) std::nth_element(begin, begin + (n - 1), end, comp);
+	std::sort(begin, begin + n, comp);
+}
+
+
+//============================================================================
+/**
+ * @brief move the n largest (descending) followed by the n smallest (ascending) to the front of
+ * the range in place
+ * @return end of the selected elements
+*/
+template <typename It, typename Compare>
+static It select_extremes(It begin, It end, size_t n, Compare desc)
+{
+	select_front(begin, end, n, desc);
+	select_front(begin + n, end, n, [&](auto const& a, auto const& b) { return desc(b, a); });
+	return begin + 2 * n;
+}
+
 std::vector<std::string> exchange_view_opps = {
 	"UNIFORM", "LINEAR_DECREASE", "LINEAR_INCREASE","CONDITIONAL_SPLIT","UNIFORM_SPLIT",
 	"CONSTANT"
@@ -136,27 +172,59 @@ AGIS_API ExchangeView Exchange::get_exchange_view(
 	if (row > 0) { throw std::runtime_error("Row must be <= 0"); }
 	auto number_assets = (N == -1) ? this->assets.size() : static_cast<size_t>(N);
 
+	// resolve the column once instead of a header lookup per asset
+	auto col_index = this->get_column_index(col);
+	if (col_index.is_exception()) AGIS_THROW(col_index.get_exception());
+	auto column_index = col_index.unwrap();
+	auto panel_row = row == 0 ? this->__get_panel_row(column_index) : std::nullopt;
+
+	// without panic a failed read only excludes the asset, so the read is inlined into the
+	// callable overload's gather loop with NaN as the missing value
+	if (!panic) {
+		return this->get_exchange_view(
+			[&](Asset const& asset) -> double {
+				if (panel_row) return (*panel_row)[asset.get_asset_index() - this->exchange_offset];
+				auto val = asset.get_asset_feature(column_index, row);
+				return val.has_value() ? val.value() : AGIS_NAN;
+			},
+			query_type,
+			N
+		);
+	}
+
 	ExchangeView exchange_view(this, number_assets);
 	auto& view = exchange_view.view;
 
-	for (auto& asset : this->assets)
-	{
-		if (!asset || !asset->__in_exchange_view) continue;
-		if (!asset->__is_streaming)
-		{
-			if (panic) throw std::runtime_error("invalid asset found"); 
-			continue;
-		}
-		auto val = asset->get_asset_feature(col, row);
-		if (!val.has_value()){
-			if (!panic) continue;
-			else AGIS_THROW("exchange view faileed");
+	// only visit assets that have not expired
+	auto const& live_assets = this->exchanges->__get_live_assets();
+	live_assets.for_each_set(
+		this->exchange_offset,
+		this->exchange_offset + this->assets.size(),
+		[&](size_t asset_index) {
+			auto& asset = this->assets[asset_index - this->exchange_offset];
+			if (!asset->__in_exchange_view) return;
+			if (!asset->__is_streaming)
+			{
+				if (panic) throw std::runtime_error("invalid asset found"); 
+				return;
+			}
+			double v;
+			if (panel_row) {
+				v = (*panel_row)[asset_index - this->exchange_offset];
+			}
+			else {
+				auto val = asset->get_asset_feature(column_index, row);
+				if (!val.has_value()) {
+					if (!panic) return;
+					else AGIS_THROW("exchange view faileed");
+				}
+				v = val.value();
+			}
+			if (std::isnan(v)) return;
+			view.emplace_back(asset_index, v);
+			view.back().live = true;
 		}
-		auto v = val.value();
-		if (std::isnan(v)) continue;
-		view.emplace_back( asset->get_asset_index(), v );
-		view.back().live = true;
-	}
+	);
 	if (view.size() == 1) { return exchange_view; }
 	exchange_view.sort(number_assets, query_type);
 	return exchange_view;
@@ -175,21 +243,26 @@ AGIS_API ExchangeView Exchange::get_exchange_view(
 	ExchangeView exchange_view(this, number_assets);
 	auto& view = exchange_view.view;
 	std::expected<double, AgisStatusCode> val;
-	for (auto const& asset : this->assets)
-	{
-		if (!asset || !asset->__in_exchange_view) continue;	// asset not in view, or disabled
-		if (!asset->__is_streaming) continue;				// asset is not streaming
-		val = func(asset);
-		if (!val.has_value()) {
-			if (panic) AGIS_THROW("exchange view failed");
-			else continue;
+	auto const& live_assets = this->exchanges->__get_live_assets();
+	live_assets.for_each_set(
+		this->exchange_offset,
+		this->exchange_offset + this->assets.size(),
+		[&](size_t asset_index) {
+			auto const& asset = this->assets[asset_index - this->exchange_offset];
+			if (!asset->__in_exchange_view) return;	// asset disabled
+			if (!asset->__is_streaming) return;		// asset is not streaming
+			val = func(asset);
+			if (!val.has_value()) {
+				if (panic) AGIS_THROW("exchange view failed");
+				else return;
+			}
+			auto x = val.value();			
+			// check if x is nan (asset filter operations will cause this)
+			if(std::isnan(x)) return;
+			view.emplace_back(asset_index, x);
+			view.back().live = true;
 		}
-		auto x = val.value();			
-		// check if x is nan (asset filter operations will cause this)
-		if(std::isnan(x)) continue;
-		view.emplace_back(asset->get_asset_index(), x);
-		view.back().live = true;
-	}
+	);
 
 	exchange_view.sort(number_assets, query_type);
 	return exchange_view;
@@ -198,6 +271,192 @@ AGIS_API ExchangeView Exchange::get_exchange_view(
 
 
 
+//============================================================================
+bool Exchange::__is_visible(size_t position) const noexcept
+{
+	auto const& asset = this->assets[position];
+	return asset->__in_exchange_view && asset->__is_streaming;
+}
+
+
+//============================================================================
+AtomicBitmap const& Exchange::__get_live_assets() const noexcept
+{
+	return this->exchanges->__get_live_assets();
+}
+
+
+//============================================================================
+void Exchange::gather_column(size_t col_index, int row, ExchangeColumnBuffer& buffer) const noexcept
+{
+	buffer.clear();
+	buffer.asset_index.reserve(this->assets.size());
+	buffer.values.reserve(this->assets.size());
+	// the current row of a panel column is one contiguous read, a lagged row of an unaligned
+	// asset is not the panel's previous row so those read the asset's own data
+	auto panel_row = row == 0 ? this->__get_panel_row(col_index) : std::nullopt;
+	auto const& live_assets = this->exchanges->__get_live_assets();
+	live_assets.for_each_set(
+		this->exchange_offset,
+		this->exchange_offset + this->assets.size(),
+		[&](size_t asset_index) {
+			auto const& asset = this->assets[asset_index - this->exchange_offset];
+			if (!asset->__in_exchange_view || !asset->__is_streaming) return;
+			if (!asset->__valid_row(row)) return;
+			// column major, read straight from the data without the expected wrapper
+			double v = panel_row
+				? (*panel_row)[asset_index - this->exchange_offset]
+				: asset->data[col_index * asset->rows + asset->current_index - 1 + row];
+			if (std::isnan(v)) return;
+			buffer.asset_index.push_back(asset_index);
+			buffer.values.push_back(v);
+		}
+	);
+}
+
+
+//============================================================================
+ExchangeView Exchange::get_exchange_view(
+	size_t col_index,
+	ExchangeColumnBuffer& buffer,
+	int row,
+	ExchangeQueryType query_type,
+	int N) const
+{
+	this->gather_column(col_index, row, buffer);
+	auto count = buffer.size();
+	auto number_assets = (N == -1) ? count : static_cast<size_t>(N);
+
+	// select on a permutation of the gathered indices so the values are never moved
+	auto& order = buffer.order;
+	order.resize(count);
+	std::iota(order.begin(), order.end(), 0);
+	auto const& values = buffer.values;
+	auto desc = [&](size_t a, size_t b) { return values[a] > values[b]; };
+	auto asc = [&](size_t a, size_t b) { return values[a] < values[b]; };
+	size_t selected = std::min(count, number_assets);
+	if (count > number_assets) {
+		switch (query_type) {
+			case ExchangeQueryType::NSmallest:
+				select_front(order.begin(), order.end(), selected, asc);
+				break;
+			case ExchangeQueryType::NLargest:
+				select_front(order.begin(), order.end(), selected, desc);
+				break;
+			case ExchangeQueryType::NExtreme:
+				selected = select_extremes(order.begin(), order.end(), number_assets / 2, desc) - order.begin();
+				break;
+			default:
+				break;
+		}
+	}
+
+	ExchangeView exchange_view(this, selected);
+	for (size_t i = 0; i < selected; i++) {
+		exchange_view.view.emplace_back(buffer.asset_index[order[i]], values[order[i]], true);
+	}
+	return exchange_view;
+}
+
+
+//============================================================================
+static void apply_cross_section(
+	std::vector<ExchangeViewAllocation>& view,
+	CrossSectionTransform transform,
+	double param)
+{
+	auto n = view.size();
+	if (!n) return;
+	switch (transform)
+	{
+	case CrossSectionTransform::RANK: {
+		std::vector<size_t> order(n);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return view[a].allocation_amount < view[b].allocation_amount;
+		});
+		// tied values share the average of the ranks they span
+		for (size_t i = 0; i < n;) {
+			size_t j = i;
+			double v = view[order[i]].allocation_amount;
+			while (j + 1 < n && view[order[j + 1]].allocation_amount == v) j++;
+			double rank = 0.5 * static_cast<double>(i + j) + 1.0;
+			for (size_t k = i; k <= j; k++) view[order[k]].allocation_amount = rank;
+			i = j + 1;
+		}
+		break;
+	}
+	case CrossSectionTransform::DEMEAN:
+	case CrossSectionTransform::ZSCORE: {
+		Agis::Kernels::Moments moments;
+		for (auto const& allocation : view) moments.add(allocation.allocation_amount);
+		double scale = 1.0;
+		if (transform == CrossSectionTransform::ZSCORE) {
+			double stdev = n > 1 ? std::sqrt(moments.variance_x()) : 0.0;
+			scale = stdev > 0.0 ? 1.0 / stdev : 0.0;
+		}
+		for (auto& allocation : view) {
+			allocation.allocation_amount = (allocation.allocation_amount - moments.mean_x) * scale;
+		}
+		break;
+	}
+	case CrossSectionTransform::WINSORISE: {
+		std::vector<double> values(n);
+		for (size_t i = 0; i < n; i++) values[i] = view[i].allocation_amount;
+		auto lower_rank = static_cast<size_t>(std::floor(param * static_cast<double>(n - 1)));
+		auto upper_rank = static_cast<size_t>(std::ceil((1.0 - param) * static_cast<double>(n - 1)));
+		std::nth_element(values.begin(), values.begin() + lower_rank, values.end());
+		double lower = values[lower_rank];
+		std::nth_element(values.begin(), values.begin() + upper_rank, values.end());
+		double upper = values[upper_rank];
+		for (auto& allocation : view) {
+			allocation.allocation_amount = std::clamp(allocation.allocation_amount, lower, upper);
+		}
+		break;
+	}
+	}
+}
+
+
+//============================================================================
+std::expected<std::shared_ptr<ExchangeView const>, AgisException> Exchange::get_cross_section(
+	std::string const& col,
+	CrossSectionTransform transform,
+	double param,
+	int row) const
+{
+	if (row > 0) return std::unexpected<AgisException>(AGIS_EXCEP("Row must be <= 0"));
+	if (transform == CrossSectionTransform::WINSORISE && (param < 0.0 || param >= 0.5)) {
+		return std::unexpected<AgisException>(AGIS_EXCEP("winsorise quantile must be in [0, 0.5)"));
+	}
+	auto col_index = this->get_column_index(col);
+	if (col_index.is_exception()) return std::unexpected<AgisException>(AGIS_EXCEP(col_index.get_exception()));
+
+	auto key = std::format("{}|{}|{}|{}", col, row, static_cast<int>(transform), param);
+	std::shared_ptr<CrossSectionEntry> entry;
+	{
+		std::lock_guard<std::mutex> lock(this->cross_section_mutex);
+		auto& slot = this->cross_section_cache[key];
+		if (!slot) slot = std::make_shared<CrossSectionEntry>();
+		entry = slot;
+	}
+
+	// the entry is held by shared_ptr so a step clearing the cache mid computation does not free it
+	std::call_once(entry->once, [&]() {
+		ExchangeColumnBuffer buffer;
+		this->gather_column(col_index.unwrap(), row, buffer);
+		auto exchange_view = std::make_shared<ExchangeView>(this, buffer.size());
+		auto& view = exchange_view->view;
+		for (size_t i = 0; i < buffer.size(); i++) {
+			view.emplace_back(buffer.asset_index[i], buffer.values[i], true);
+		}
+		apply_cross_section(view, transform, param);
+		entry->view = std::move(exchange_view);
+	});
+	return entry->view;
+}
+
+
 //============================================================================
 AgisResult<bool> Exchange::__set_market_asset(
 	std::string const& asset_id,
@@ -233,18 +492,10 @@ AgisResult<bool> Exchange::__set_market_asset(
 
 	if(!beta_lookback.has_value()) return AgisResult<bool>(true);
 
-	// load the beta columns in for each asset
-	std::for_each(this->assets.begin(), this->assets.end(), [&](const auto& asset_mid) {
-		// calculate rolling beta column
-		if (asset_mid->get_asset_id() != asset_id) {
-			asset_mid->__set_beta(market_asset_, beta_lookback.value());
-		}
-		// adjust the lookback of the market asset to line up with the others
-		else {
-			asset_mid->__is_market_asset = true;
-			asset_mid->__set_warmup(beta_lookback.value());
-		}
-		});
+	// load the beta columns in for each asset, the market asset's beta against itself is 1
+	AGIS_DO_OR_RETURN(this->__set_beta_vectors(market_asset_, beta_lookback.value()), bool);
+	market_asset_->__is_market_asset = true;
+	market_asset_->__set_warmup(beta_lookback.value());
 	
 	// once market asset has been added rebuild the exchange to account for the new
 	// asset warmup period needed
@@ -355,10 +606,72 @@ AgisResult<bool> Exchange::validate()
 }
 
 
+//============================================================================
+void Exchange::__build_observer_dispatch()
+{
+	this->col_observer_dispatch.clear();
+	this->observer_dispatch.clear();
+
+	// record each asset's range into the tables first, spans are only taken once the
+	// vectors have stopped growing
+	std::vector<std::pair<size_t, size_t>> col_ranges(this->assets.size());
+	std::vector<std::pair<size_t, size_t>> ranges(this->assets.size());
+	for (size_t i = 0; i < this->assets.size(); i++) {
+		auto& asset = this->assets[i];
+		col_ranges[i].first = this->col_observer_dispatch.size();
+		ranges[i].first = this->observer_dispatch.size();
+		for (auto& [name, observer] : asset->observers) {
+			auto col_observer = dynamic_cast<DataFrameColObserver*>(observer);
+			if (col_observer) this->col_observer_dispatch.push_back(col_observer);
+			else this->observer_dispatch.push_back(observer);
+		}
+		col_ranges[i].second = this->col_observer_dispatch.size();
+		ranges[i].second = this->observer_dispatch.size();
+	}
+
+	for (size_t i = 0; i < this->assets.size(); i++) {
+		auto& asset = this->assets[i];
+		asset->col_observer_span = std::span<DataFrameColObserver* const>(
+			this->col_observer_dispatch.data() + col_ranges[i].first,
+			col_ranges[i].second - col_ranges[i].first
+		);
+		asset->observer_span = std::span<AssetObserver* const>(
+			this->observer_dispatch.data() + ranges[i].first,
+			ranges[i].second - ranges[i].first
+		);
+		asset->observer_dispatch_valid = true;
+	}
+}
+
+
+//============================================================================
+void Exchange::__build_observers()
+{
+	this->__build_observer_dispatch();
+
+	// precomputed columns only depend on their own asset's data, building them is the bulk of
+	// the reset cost so do it across all assets at once
+	tbb::parallel_for_each(
+		this->col_observer_dispatch.begin(),
+		this->col_observer_dispatch.end(),
+		[](DataFrameColObserver* observer) {
+			observer->__ensure_built();
+		}
+	);
+}
+
+
 //============================================================================
 void Exchange::reset()
 {
 	this->current_index = 0;
+	{
+		std::lock_guard<std::mutex> lock(this->cross_section_mutex);
+		this->cross_section_cache.clear();
+	}
+
+	// observers may have been added or removed by strategies since the last build
+	this->__build_observers();
 	for(auto& asset : this->assets)
 	{
 		asset->__reset(this->dt_index[0]);
@@ -395,6 +708,7 @@ std::expected<bool, AgisException> Exchange::build(size_t exchange_offset_)
 	auto t0 = this->dt_index[0];
 	this->dt_index_size = get<1>(datetime_index_);
 	this->candles = 0;
+	this->__build_observers();
 
 	for (auto& asset : this->assets) {
 		// test to see if asset is alligned with the exchage's datetime index
@@ -409,6 +723,8 @@ std::expected<bool, AgisException> Exchange::build(size_t exchange_offset_)
 		this->candles += asset->get_rows();
 	}
 
+	this->__build_panels();
+
 	// build any asset tables
 	for (auto& table : this->asset_tables) {
 		auto res = table.second->__build();
@@ -417,7 +733,7 @@ std::expected<bool, AgisException> Exchange::build(size_t exchange_offset_)
 
 	// disable all observers, force strategy to re-init them
 	for (auto& obv : this->asset_observers) {
-		obv->set_touch(false);
+		obv->__clear_refs();
 	}
 
 	this->exchange_offset = exchange_offset_;
@@ -452,6 +768,12 @@ bool Exchange::step(ThreadSafeVector<size_t>& expired_assets)
 		return false;
 	}
 
+	// cross sections computed last step are stale once the assets move forward
+	{
+		std::lock_guard<std::mutex> lock(this->cross_section_mutex);
+		this->cross_section_cache.clear();
+	}
+
 	// set exchange time to compare to assets
 	this->exchange_time = this->dt_index[this->current_index];
 
@@ -463,7 +785,7 @@ bool Exchange::step(ThreadSafeVector<size_t>& expired_assets)
 	// Define a lambda function that processes each asset
 	auto process_asset = [&](auto& asset) {
 		// if asset is expired skip
-		if (!asset || asset->__is_expired)
+		if (asset->__is_expired)
 		{
 			return;
 		}
@@ -637,10 +959,10 @@ AgisResult<bool> Exchange::restore(
 		// build the beta vectors if the market asset has a beta lookback
 		if (this->market_asset.value()->beta_lookback.has_value())
 		{
-			for (auto& asset : this->assets)
-			{
-				asset->__set_beta(*new_market_asset_ptr, this->market_asset.value()->beta_lookback.value());
-			}
+			AGIS_DO_OR_RETURN(
+				this->__set_beta_vectors(*new_market_asset_ptr, this->market_asset.value()->beta_lookback.value()),
+				bool
+			);
 		}
 	}
 
@@ -651,7 +973,7 @@ AgisResult<bool> Exchange::restore(
 //============================================================================
 bool Exchange::__is_valid_order(std::unique_ptr<Order>& order) const
 {
-	AssetPtr asset = this->assets[order->get_asset_index()];
+	auto const& asset = this->assets[order->get_asset_index() - this->exchange_offset];
 	if (!asset->__is_streaming) return false;
 	if (order->get_order_type() != OrderType::MARKET_ORDER) {
 		if (!order->get_limit().has_value())
@@ -762,15 +1084,108 @@ void Exchange::__process_limit_order(std::unique_ptr<Order>& order, bool on_clos
 }
 
 
+//============================================================================
+AgisResult<bool> Exchange::add_panel_column(std::string const& col)
+{
+	auto col_index = this->get_column_index(col);
+	if (col_index.is_exception()) return AgisResult<bool>(col_index.get_exception());
+	if (this->panels.contains(col_index.unwrap())) return AgisResult<bool>(true);
+	this->panels.emplace(col_index.unwrap(), std::vector<double>());
+
+	// panels are laid out against the datetime index, force a rebuild
+	this->is_built = false;
+	return AgisResult<bool>(true);
+}
+
+
+//============================================================================
+std::optional<std::span<double const>> Exchange::__get_panel_row(size_t col_index, int row) const noexcept
+{
+	if (row > 0) return std::nullopt;
+	auto it = this->panels.find(col_index);
+	if (it == this->panels.end()) return std::nullopt;
+	auto t = static_cast<long long>(this->current_index) - 1 + row;
+	auto asset_count = this->assets.size();
+	if (t < 0 || it->second.size() < (static_cast<size_t>(t) + 1) * asset_count) return std::nullopt;
+	return std::span<double const>(it->second.data() + t * asset_count, asset_count);
+}
+
+
+//============================================================================
+void Exchange::__build_panels()
+{
+	if (this->panels.empty()) return;
+	auto asset_count = this->assets.size();
+	for (auto& [col_index, panel] : this->panels) {
+		panel.assign(this->dt_index_size * asset_count, std::numeric_limits<double>::quiet_NaN());
+	}
+
+	// each asset fills its own column of every panel, aligned to the exchange index with a
+	// forward merge of the two sorted datetime indexes
+	std::vector<size_t> positions(asset_count);
+	std::iota(positions.begin(), positions.end(), 0);
+	tbb::parallel_for_each(positions.begin(), positions.end(), [&](size_t a) {
+		auto const& asset = this->assets[a];
+		auto asset_dt_index = asset->__get_dt_index(false);
+		size_t t = 0;
+		for (size_t r = 0; r < asset_dt_index.size(); r++) {
+			while (t < this->dt_index_size && this->dt_index[t] < asset_dt_index[r]) t++;
+			if (t == this->dt_index_size) break;
+			if (this->dt_index[t] != asset_dt_index[r]) continue;
+			for (auto& [col_index, panel] : this->panels) {
+				panel[t * asset_count + a] = asset->data[col_index * asset->rows + r];
+			}
+		}
+	});
+}
+
+
+//============================================================================
+AgisResult<bool> Exchange::build_zone_maps(std::string const& col, size_t block_size)
+{
+	auto col_index = this->get_column_index(col);
+	if (col_index.is_exception()) return AgisResult<bool>(col_index.get_exception());
+	auto column_index = col_index.unwrap();
+	std::atomic<bool> failed = false;
+	tbb::parallel_for_each(this->assets.begin(), this->assets.end(), [&](auto& asset) {
+		if (asset->__build_zone_map(column_index, block_size).is_exception()) failed = true;
+	});
+	if (failed) return AgisResult<bool>(AGIS_EXCEP("failed to build zone map for column: " + col));
+	return AgisResult<bool>(true);
+}
+
+
+//============================================================================
+AgisResult<bool> Exchange::__set_beta_vectors(AssetPtr const& market_asset_, size_t beta_lookback)
+{
+	// fetch the market data once, every asset only reads it
+	auto market_dt_index = market_asset_->__get_dt_index(false);
+	auto market_close = market_asset_->__get_column(market_asset_->__get_close_index());
+	std::vector<char> failed(this->assets.size(), false);
+	tbb::parallel_for(size_t(0), this->assets.size(), [&](size_t i) {
+		failed[i] = !this->assets[i]->__set_beta(market_dt_index, market_close, beta_lookback);
+	});
+
+	// report every asset whose beta could not be set, i.e. fewer rows than the lookback
+	std::string failed_ids;
+	for (size_t i = 0; i < this->assets.size(); i++) {
+		if (!failed[i]) continue;
+		if (!failed_ids.empty()) failed_ids += ", ";
+		failed_ids += this->assets[i]->get_asset_id();
+	}
+	if (!failed_ids.empty()) return AgisResult<bool>(AGIS_EXCEP("failed to set beta for: " + failed_ids));
+	return AgisResult<bool>(true);
+}
+
+
 //============================================================================
 void Exchange::__set_volatility_lookback(size_t window_size)
 {
 	this->volatility_lookback = window_size;
 	if (window_size == 0) return;
-	for(auto& asset : this->assets)
-	{
+	tbb::parallel_for_each(this->assets.begin(), this->assets.end(), [&](auto& asset) {
 		asset->__set_volatility(window_size);
-	}
+	});
 }
 
 
@@ -792,8 +1207,8 @@ std::expected<bool, AgisException> Exchange::load_trading_calendar(std::string c
 //============================================================================
 double Exchange::__get_market_price(size_t index, bool on_close) const
 {
-	auto const& asset = this->assets[index];
-	if (!asset) return 0.0f;
+	// index is the global asset index, scale it into the exchange's asset vector
+	auto const& asset = this->assets[index - this->exchange_offset];
 	if (!asset->__is_streaming) return 0.0f;
 	return asset->__get_market_price(on_close);
 }
@@ -832,32 +1247,24 @@ bool compareBySecondValueDesc(const ExchangeViewAllocation& a, const ExchangeVie
 //============================================================================
 void ExchangeView::sort(size_t N, ExchangeQueryType sort_type)
 {
+	// nothing to select, every allocation is returned as is
 	if (view.size() <= N) { return; }
 	switch (sort_type) {
 		case(ExchangeQueryType::Default):
 			view.erase(view.begin() + N, view.end());
 			return;
 		case(ExchangeQueryType::NSmallest):
-			std::partial_sort(
-				view.begin(),
-				view.begin() + N,
-				view.end(),
-				compareBySecondValueAsc);
+			select_front(view.begin(), view.end(), N, compareBySecondValueAsc);
 			view.erase(view.begin() + N, view.end());
 			return;
 		case(ExchangeQueryType::NLargest):
-			std::partial_sort(
-				view.begin(),
-				view.begin() + N,
-				view.end(),
-				compareBySecondValueDesc);
+			select_front(view.begin(), view.end(), N, compareBySecondValueDesc);
 			view.erase(view.begin() + N, view.end());
 			return;
 		case(ExchangeQueryType::NExtreme): {
-			auto n = N / 2;
-			std::partial_sort(view.begin(), view.begin() + n, view.end(), compareBySecondValueDesc);
-			std::partial_sort(view.begin() + n, view.begin() + N, view.end(), compareBySecondValueAsc);
-			view.erase(view.begin() + n, view.end() - n);
+			// N/2 largest then N/2 smallest, both tails selected in place
+			auto last = select_extremes(view.begin(), view.end(), N / 2, compareBySecondValueDesc);
+			view.erase(last, view.end());
 			return;
 		}
 	}
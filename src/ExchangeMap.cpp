@@ -23,6 +23,10 @@ void ExchangeMap::restore(rapidjson::Document const& j)
 	}
 
 	this->asset_counter = 0;
+	// failures are collected and thrown once all exchanges are done, throwing from a parallel
+	// algorithm terminates
+	std::mutex restore_mutex;
+	std::string restore_errors;
 	// Process the exchange items 
 	std::for_each(std::execution::par, exchangeItems.begin(), exchangeItems.end(), [&](const auto& exchange) {
 		auto const& exchange_id_ = exchange.first;
@@ -38,7 +42,12 @@ void ExchangeMap::restore(rapidjson::Document const& j)
 			exchange_json["market_asset"].GetString(), exchange_json["market_warmup"].GetInt()
 		);
 
-		this->restore_exchange(exchange_id_, std::nullopt, market_asset);
+		auto res = this->restore_exchange(exchange_id_, std::nullopt, market_asset);
+		if (res.is_exception()) {
+			std::lock_guard<std::mutex> lock(restore_mutex);
+			restore_errors += exchange_id_ + ": " + res.get_exception() + "\n";
+			return;
+		}
 
 
 		// set volatility lookback
@@ -46,6 +55,7 @@ void ExchangeMap::restore(rapidjson::Document const& j)
 		size_t volatility_lookback = exchange_json["volatility_lookback"].GetUint64();
 		exchange_ptr->__set_volatility_lookback(volatility_lookback);
 		});
+	if (!restore_errors.empty()) AGIS_THROW(restore_errors);
 
 	// set market assets
 	for (auto& exchange : this->exchanges)
@@ -63,7 +73,19 @@ void ExchangeMap::restore(rapidjson::Document const& j)
 		int covariance_step = j["covariance_step"].GetInt();
 
 		// Call the function with the extracted values
-		this->init_covariance_matrix(covariance_lookback, covariance_step);
+		auto res = this->init_covariance_matrix(covariance_lookback, covariance_step);
+		if (res.is_exception()) AGIS_THROW(res.get_exception());
+
+		// re-apply the estimator, older saves without one use the sample estimator
+		if (j.HasMember("covariance_estimator")) {
+			auto estimator = StringToCovarianceEstimator(j["covariance_estimator"].GetString());
+			if (!estimator.has_value()) AGIS_THROW(estimator.error().what());
+			size_t factor_count = j.HasMember("covariance_factor_count")
+				? j["covariance_factor_count"].GetUint64()
+				: 0;
+			res = this->set_covariance_estimator(estimator.value(), factor_count);
+			if (res.is_exception()) AGIS_THROW(res.get_exception());
+		}
 	}
 }
 
@@ -128,18 +150,21 @@ AGIS_API AgisResult<bool> ExchangeMap::set_covariance_matrix_state(bool enabled)
 {
 	// no cov matrix exists
 	if (!this->covariance_matrix) return AgisResult<bool>(AGIS_EXCEP("covariance matrix not initialized"));
-	// disable it by removing all asset observers
-	if (!enabled) {
-		this->covariance_matrix->clear_observers();
-	}
-	// enable it by adding all asset observers	
-	else {
-		this->covariance_matrix->set_asset_observers();
-	}
+	this->covariance_matrix->set_enabled(enabled);
+
+	return AgisResult<bool>(true);
+}
 
+//============================================================================
+AGIS_API AgisResult<bool> ExchangeMap::set_covariance_estimator(CovarianceEstimator estimator, size_t factor_count)
+{
+	if (!this->covariance_matrix) return AgisResult<bool>(AGIS_EXCEP("covariance matrix not initialized"));
+	auto res = this->covariance_matrix->set_estimator(estimator, factor_count);
+	if (!res.has_value()) return AgisResult<bool>(res.error());
 	return AgisResult<bool>(true);
 }
 
+
 //============================================================================
 AgisResult<std::shared_ptr<AgisCovarianceMatrix>> ExchangeMap::get_covariance_matrix() const
 {
@@ -332,6 +357,17 @@ AgisResult<AssetPtr> ExchangeMap::get_asset(size_t index) const
 	return AgisResult<AssetPtr>(this->assets[index]);
 }
 
+//============================================================================
+std::expected<AssetHandle, AgisStatusCode> ExchangeMap::get_asset_handle(size_t index) const noexcept
+{
+	if (index >= this->asset_routes.size())
+	{
+		return std::unexpected<AgisStatusCode>(AgisStatusCode::OUT_OF_RANGE);
+	}
+	return AssetHandle(index, this->asset_routes[index]);
+}
+
+
 //============================================================================
 AgisResult<AssetPtr> Exchange::__remove_asset(size_t asset_index)
 {
@@ -340,6 +376,9 @@ AgisResult<AssetPtr> Exchange::__remove_asset(size_t asset_index)
 	// delete the asset at this index from the assets vector
 	this->assets.erase(this->assets.begin() + asset_index);
 
+	// panel columns are laid out by asset position, drop them until the next build
+	for (auto& [col_index, panel] : this->panels) panel.clear();
+
 	return AgisResult<AssetPtr>(asset);
 }
 
@@ -482,7 +521,6 @@ ExchangeMap::__get_market_price(std::string& asset_id, bool on_close) const
 {
 	auto index = this->asset_map.at(asset_id);
 	auto const& asset = this->assets[index];
-	if (!asset) return 0.0f;
 	if (!asset->__is_streaming) return 0.0f;
 	return asset->__get_market_price(on_close);
 }
@@ -492,8 +530,7 @@ ExchangeMap::__get_market_price(std::string& asset_id, bool on_close) const
 double
 ExchangeMap::__get_market_price(size_t asset_index, bool on_close) const noexcept
 {
-	auto const& asset = this->assets[asset_index];
-	if (!asset) return 0.0f;
+	auto asset = this->asset_routes[asset_index];
 	if (!asset->__is_streaming) return 0.0f;
 	return asset->__get_market_price(on_close);
 }
@@ -503,13 +540,7 @@ ExchangeMap::__get_market_price(size_t asset_index, bool on_close) const noexcep
 AgisResult<std::string> ExchangeMap::get_asset_id(size_t index) const
 {
 	if (index >= this->assets.size()) return AgisResult<std::string>(AGIS_EXCEP("Index out of range"));
-	if (this->assets[index]) {
-		return AgisResult<std::string>(this->assets[index]->get_asset_id());
-	}
-	else {
-		return AgisResult<std::string>(this->assets_expired[index]->get_asset_id());
-
-	}
+	return AgisResult<std::string>(this->assets[index]->get_asset_id());
 }
 
 //============================================================================
@@ -529,18 +560,8 @@ void ExchangeMap::__reset()
 {
 	this->current_index = 0;
 
-	// reset assets that were expired and bring them back in to view
-	for (auto& asset : this->assets_expired) {
-		if (asset == nullptr) continue;
-		this->__set_asset(asset->__get_index(), asset);
-	}
-	// fill assets_expired with nullptr
-	std::fill(assets_expired.begin(), assets_expired.end(), nullptr);
-
-	for (auto& asset : this->assets)
-	{
-		this->__set_asset(asset->__get_index(), asset);
-	}
+	// bring any assets that expired back in to view
+	this->live_assets.fill(true);
 
 	// Move exchange time back to 0
 	for (auto& exchange : this->exchanges)
@@ -548,15 +569,7 @@ void ExchangeMap::__reset()
 		exchange.second->reset();
 	}
 	this->expired_asset_index.clear();
-}
-
-
-//============================================================================
-void ExchangeMap::__set_asset(size_t asset_index, std::shared_ptr<Asset> asset)
-{
-	LOCK_GUARD
-		this->assets[asset_index] = asset;
-	UNLOCK_GUARD
+	if (this->covariance_matrix) this->covariance_matrix->reset();
 }
 
 
@@ -588,21 +601,18 @@ void ExchangeMap::__process_orders(AgisRouter& router, bool on_close)
 //============================================================================
 std::optional<bool> ExchangeMap::__place_order(std::unique_ptr<Order> order) noexcept
 {
-	if (order->get_asset_index() >= this->assets.size()) return std::nullopt;
-	auto& asset = this->assets[order->get_asset_index()];
-	auto it = this->exchanges.find(asset->get_exchange_id());
-	if (it == this->exchanges.end()) return std::nullopt;
-	it->second->__place_order(std::move(order));
+	if (order->get_asset_index() >= this->exchange_routes.size()) return std::nullopt;
+	auto exchange = this->exchange_routes[order->get_asset_index()];
+	if (!exchange) return std::nullopt;
+	exchange->__place_order(std::move(order));
 	return true;
-	;
 }
 
 
 //============================================================================
 void ExchangeMap::__process_order(bool on_close, OrderPtr& order)
 {
-	auto& asset = this->assets[order->get_asset_index()];
-	auto& exchange = this->exchanges.at(asset->get_exchange_id());
+	auto exchange = this->exchange_routes[order->get_asset_index()];
 	exchange->__process_order(on_close, order);
 }
 
@@ -663,32 +673,36 @@ AGIS_API std::expected<bool, AgisException> ExchangeMap::__build()
 	this->dt_index_size = get<1>(datetime_index_);
 	this->is_built = true;
 	this->current_time = this->dt_index[0];
-	// empty vector to contain expired assets
-	this->assets_expired.resize(this->assets.size(), nullptr);
-	std::fill(assets_expired.begin(), assets_expired.end(), nullptr);
+	// all assets start live, expired assets are cleared from the bitmap on step
+	this->live_assets.resize(this->assets.size(), true);
+
+	// materialise the asset index routing tables used for order routing and hot accessors
+	this->asset_routes.assign(this->assets.size(), nullptr);
+	this->exchange_routes.assign(this->assets.size(), nullptr);
+	for (auto& [id, exchange] : this->exchanges)
+	{
+		for (auto const& asset : exchange->get_assets())
+		{
+			auto index = asset->get_asset_index();
+			this->asset_routes[index] = asset.get();
+			this->exchange_routes[index] = exchange.get();
+		}
+	}
 	return true;
 }
 
 void ExchangeMap::__clean_up()
 {
-	// search through all observers, if no strategy tried to build them then remove
+	// search through all observers, if no strategy holds a reference after building then remove
 	for (auto& exchange : this->exchanges)
 	{
 		auto& observers = exchange.second->__get_asset_observers();
-		for (auto obv_itr = observers.begin(); obv_itr != observers.end(); )
-		{
-			auto& observer = *obv_itr;
-			if (!observer->get_touch())
-			{
-				auto asset = observer->get_asset_ptr();
-				asset->remove_observer(observer.get());
-				obv_itr = observers.erase(obv_itr);
-			}
-			else
-			{
-				++obv_itr;
-			}
-		}
+		std::erase_if(observers, [](auto const& observer) {
+			if (observer->get_ref_count()) return false;
+			auto asset = observer->get_asset_ptr();
+			asset->remove_observer(observer.get());
+			return true;
+		});
 	}
 }
 
@@ -730,14 +744,14 @@ bool ExchangeMap::step()
 		this->exchanges.end(),
 		process_exchange);
 
-	// remove and expired assets;
+	// publish any expired assets, the slots in the assets vector are left in place
 	for (auto asset_index : expired_asset_index)
 	{
-		std::shared_ptr<Asset> expired_asset = this->assets[asset_index];
-		this->assets_expired[asset_index] = expired_asset;
-		this->__set_asset(asset_index, nullptr);
+		this->live_assets.reset(asset_index);
 	}
 
+	if (this->covariance_matrix) this->covariance_matrix->step();
+
 	this->current_index++;
 	return true;
 }
@@ -749,7 +763,9 @@ void ExchangeMap::__clear()
 	this->exchanges.clear();
 	this->asset_map.clear();
 	this->assets.clear();
-	this->assets_expired.clear();
+	this->live_assets.resize(0);
+	this->asset_routes.clear();
+	this->exchange_routes.clear();
 	this->expired_asset_index.clear();
 	this->current_index = 0;
 	this->candles = 0;
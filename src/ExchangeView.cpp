@@ -91,6 +91,14 @@ AgisResult<bool> ExchangeView::vol_target_fast(double target)
 
 //============================================================================
 AgisResult<bool> ExchangeView::vol_target(double target)
+{
+	AgisCovarianceBlock cache;
+	return this->vol_target(target, cache);
+}
+
+
+//============================================================================
+AgisResult<bool> ExchangeView::vol_target(double target, AgisCovarianceBlock& cache)
 {
 	// if the view only has one asset then volatility of the portfolio is just 
 	// the volatility of the asset
@@ -104,21 +112,24 @@ AgisResult<bool> ExchangeView::vol_target(double target)
 
 	// extract vector representation of portfolio weights
 	auto exchange_map = this->exchange->__get_exchange_map();
-	VectorXd weights(exchange_map->get_asset_count());
-	weights.setZero();
+	// only the allocated assets are gathered so just their covariance sub-block is evaluated
+	std::vector<size_t> indices;
+	indices.reserve(this->view.size());
+	VectorXd weights(this->view.size());
 	// set the weights by the actual allocation amounts multiplied by the specific unit
 	// multiplier of the underlying asset. I.e. CL futures contract is 1000 barrels of oil
 	for(auto& alloc: this->view)
 	{
 		auto asset = exchange_map->get_asset(alloc.asset_index);
 		if (asset.is_exception()) return AgisResult<bool>(asset.get_exception());
-		weights(alloc.asset_index) = alloc.allocation_amount * asset.unwrap()->get_unit_multiplier();
+		weights(indices.size()) = alloc.allocation_amount * asset.unwrap()->get_unit_multiplier();
+		indices.push_back(alloc.asset_index);
 	}
 	
 	// calculate vol of existing exchange view allocation
 	auto cov_matrix = exchange_map->get_covariance_matrix();
 	if (cov_matrix.is_exception()) return AgisResult<bool>(cov_matrix.get_exception());
-	auto vol = calculate_portfolio_volatility(weights, cov_matrix.unwrap()->get_eigen_matrix());
+	auto vol = calculate_portfolio_volatility(indices, weights, *cov_matrix.unwrap(), cache);
 	if (!vol.has_value()) return AgisResult<bool>(vol.error());
 
 	// calculate the vol target
@@ -497,6 +497,14 @@ Hydra::save_state(rapidjson::Document::AllocatorType& allocator)
         if (cov_matrix->get_lookback() != 0) {
             j.AddMember("covariance_lookback", cov_matrix->get_lookback(), allocator);
             j.AddMember("covariance_step", cov_matrix->get_step_size(), allocator);
+            // user supplied factor loadings are not saved, a restored factor model re-estimates
+            // the loadings from the principal components with the same factor count
+            j.AddMember(
+                "covariance_estimator",
+                rapidjson::StringRef(CovarianceEstimatorToString(cov_matrix->get_estimator())),
+                allocator
+            );
+            j.AddMember("covariance_factor_count", cov_matrix->get_factor_count(), allocator);
         }
     }
 